@@ -0,0 +1,281 @@
+// BarnesHut.cpp : Parallel Morton-ordered quadtree construction and traversal.
+//
+#include "BarnesHut.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+const int MAX_DEPTH = 30;             // Bits per axis in a Morton key
+const uint32_t LEAF_SIZE = 8;         // Sources per leaf before a cell is split
+const int PARALLEL_LEVELS = 3;        // Cells at this depth are built as independent subtrees
+const size_t PARALLEL_GRAIN = 4096;   // Minimum bodies per thread in the parallel passes
+const int TRAVERSAL_STACK = 4 * MAX_DEPTH + 4;
+
+// Function to spread the low 32 bits of v so there is a zero between each bit
+uint64_t spreadBits(uint64_t v) {
+    v &= 0xFFFFFFFFull;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+    v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    v = (v | (v << 2)) & 0x3333333333333333ull;
+    v = (v | (v << 1)) & 0x5555555555555555ull;
+    return v;
+}
+
+// Function to return the child quadrant (0-3) a key falls in at the given level
+inline int quadrantAt(uint64_t key, int level) {
+    return static_cast<int>((key >> (2 * (MAX_DEPTH - 1 - level))) & 3);
+}
+
+// Function to sort (key, index) pairs with per-thread chunk sorts followed by merge rounds
+void parallelSort(std::vector<std::pair<uint64_t, uint32_t>>& items) {
+    size_t chunks = std::max<size_t>(1, std::min(workerCount(), items.size() / PARALLEL_GRAIN));
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t c = 0; c <= chunks; c++) bounds[c] = items.size() * c / chunks;
+
+    parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) std::sort(items.begin() + bounds[c], items.begin() + bounds[c + 1]);
+    });
+
+    for (size_t width = 1; width < chunks; width *= 2) {
+        size_t merges = (chunks + 2 * width - 1) / (2 * width);
+        parallelFor(0, merges, 1, [&](size_t begin, size_t end) {
+            for (size_t m = begin; m < end; m++) {
+                size_t left = m * 2 * width;
+                size_t middle = std::min(left + width, chunks);
+                size_t right = std::min(left + 2 * width, chunks);
+                if (middle < right) {
+                    std::inplace_merge(items.begin() + bounds[left], items.begin() + bounds[middle],
+                        items.begin() + bounds[right]);
+                }
+            }
+        });
+    }
+}
+
+} // namespace
+
+void BarnesHutTree::build(const double* x, const double* y, const double* mu, size_t count) {
+    ScopedTimer timer("tree build");
+    nodes_.clear();
+    sourceIndex_.clear();
+    for (size_t i = 0; i < count; i++) {
+        if (mu[i] > 0.0) sourceIndex_.push_back(static_cast<uint32_t>(i));
+    }
+    size_t sources = sourceIndex_.size();
+    keys_.resize(sources);
+    sourceX_.resize(sources);
+    sourceY_.resize(sources);
+    sourceMu_.resize(sources);
+    if (sources == 0) return;
+
+    // Bounding square of all sources
+    double minX = std::numeric_limits<double>::max(), minY = minX;
+    double maxX = std::numeric_limits<double>::lowest(), maxY = maxX;
+    std::mutex boundsMutex;
+    parallelFor(0, sources, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+        double lowX = std::numeric_limits<double>::max(), lowY = lowX;
+        double highX = std::numeric_limits<double>::lowest(), highY = highX;
+        for (size_t k = begin; k < end; k++) {
+            uint32_t i = sourceIndex_[k];
+            lowX = std::min(lowX, x[i]); highX = std::max(highX, x[i]);
+            lowY = std::min(lowY, y[i]); highY = std::max(highY, y[i]);
+        }
+        std::lock_guard<std::mutex> lock(boundsMutex);
+        minX = std::min(minX, lowX); maxX = std::max(maxX, highX);
+        minY = std::min(minY, lowY); maxY = std::max(maxY, highY);
+    });
+    rootHalfSize_ = 0.5 * std::max(maxX - minX, maxY - minY) * 1.0001 + 1e-12;
+    rootCenterX_ = 0.5 * (minX + maxX);
+    rootCenterY_ = 0.5 * (minY + maxY);
+
+    // Morton keys, then sort sources along the curve so every cell is a contiguous range
+    std::vector<std::pair<uint64_t, uint32_t>> order(sources);
+    const double cellsPerUnit = static_cast<double>(1u << MAX_DEPTH) / (2.0 * rootHalfSize_);
+    const double maxCell = static_cast<double>((1u << MAX_DEPTH) - 1);
+    parallelFor(0, sources, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            uint32_t i = sourceIndex_[k];
+            double cx = std::min(maxCell, (x[i] - (rootCenterX_ - rootHalfSize_)) * cellsPerUnit);
+            double cy = std::min(maxCell, (y[i] - (rootCenterY_ - rootHalfSize_)) * cellsPerUnit);
+            uint64_t key = spreadBits(static_cast<uint64_t>(cx)) | (spreadBits(static_cast<uint64_t>(cy)) << 1);
+            order[k] = std::make_pair(key, i);
+        }
+    });
+    parallelSort(order);
+    parallelFor(0, sources, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            uint32_t i = order[k].second;
+            keys_[k] = order[k].first;
+            sourceIndex_[k] = i;
+            sourceX_[k] = x[i];
+            sourceY_[k] = y[i];
+            sourceMu_[k] = mu[i];
+        }
+    });
+
+    // Top levels are split serially, the subtrees below them are built concurrently
+    Cell root = { 0, sources, 0, rootCenterX_, rootCenterY_, rootHalfSize_ };
+    std::vector<Cell> subtrees;
+    collectSubtrees(root, subtrees);
+    std::vector<std::vector<Node>> subtreeNodes(subtrees.size());
+    parallelFor(0, subtrees.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) buildNode(subtreeNodes[s], subtrees[s]);
+    });
+
+    size_t nextSubtree = 0;
+    linkTopLevel(root, subtreeNodes, nextSubtree);
+}
+
+void BarnesHutTree::childCells(const Cell& cell, Cell children[4]) const {
+    size_t cursor = cell.begin;
+    double quarter = 0.5 * cell.halfSize;
+    for (int q = 0; q < 4; q++) {
+        size_t childEnd = std::partition_point(keys_.begin() + cursor, keys_.begin() + cell.end,
+            [&](uint64_t key) { return quadrantAt(key, cell.level) <= q; }) - keys_.begin();
+        children[q].begin = cursor;
+        children[q].end = childEnd;
+        children[q].level = cell.level + 1;
+        children[q].centerX = cell.centerX + ((q & 1) ? quarter : -quarter);
+        children[q].centerY = cell.centerY + ((q & 2) ? quarter : -quarter);
+        children[q].halfSize = quarter;
+        cursor = childEnd;
+    }
+}
+
+int32_t BarnesHutTree::buildNode(std::vector<Node>& nodes, const Cell& cell) const {
+    int32_t index = static_cast<int32_t>(nodes.size());
+    nodes.push_back(Node());
+    Node node = {};
+    node.centerX = cell.centerX;
+    node.centerY = cell.centerY;
+    node.halfSize = cell.halfSize;
+    node.first = static_cast<uint32_t>(cell.begin);
+    node.count = static_cast<uint32_t>(cell.end - cell.begin);
+    for (int q = 0; q < 4; q++) node.child[q] = -1;
+
+    if (node.count <= LEAF_SIZE || cell.level >= MAX_DEPTH) {
+        for (size_t k = cell.begin; k < cell.end; k++) {
+            node.mu += sourceMu_[k];
+            node.comX += sourceMu_[k] * sourceX_[k];
+            node.comY += sourceMu_[k] * sourceY_[k];
+        }
+    } else {
+        Cell children[4];
+        childCells(cell, children);
+        for (int q = 0; q < 4; q++) {
+            if (children[q].begin == children[q].end) continue;
+            int32_t child = buildNode(nodes, children[q]);
+            node.child[q] = child;
+            node.mu += nodes[child].mu;
+            node.comX += nodes[child].mu * nodes[child].comX;
+            node.comY += nodes[child].mu * nodes[child].comY;
+        }
+    }
+    node.comX /= node.mu;
+    node.comY /= node.mu;
+    nodes[index] = node;
+    return index;
+}
+
+void BarnesHutTree::collectSubtrees(const Cell& cell, std::vector<Cell>& subtrees) const {
+    if (cell.level >= PARALLEL_LEVELS || cell.end - cell.begin <= LEAF_SIZE) {
+        subtrees.push_back(cell);
+        return;
+    }
+    Cell children[4];
+    childCells(cell, children);
+    for (int q = 0; q < 4; q++) {
+        if (children[q].begin != children[q].end) collectSubtrees(children[q], subtrees);
+    }
+}
+
+int32_t BarnesHutTree::linkTopLevel(const Cell& cell, std::vector<std::vector<Node>>& subtreeNodes, size_t& nextSubtree) {
+    // Mirrors collectSubtrees so subtrees are consumed in the order they were collected
+    if (cell.level >= PARALLEL_LEVELS || cell.end - cell.begin <= LEAF_SIZE) {
+        std::vector<Node>& subtree = subtreeNodes[nextSubtree++];
+        int32_t offset = static_cast<int32_t>(nodes_.size());
+        for (Node& node : subtree) {
+            for (int q = 0; q < 4; q++) {
+                if (node.child[q] >= 0) node.child[q] += offset;
+            }
+            nodes_.push_back(node);
+        }
+        return offset;
+    }
+
+    int32_t index = static_cast<int32_t>(nodes_.size());
+    nodes_.push_back(Node());
+    Node node = {};
+    node.centerX = cell.centerX;
+    node.centerY = cell.centerY;
+    node.halfSize = cell.halfSize;
+    node.first = static_cast<uint32_t>(cell.begin);
+    node.count = static_cast<uint32_t>(cell.end - cell.begin);
+
+    Cell children[4];
+    childCells(cell, children);
+    for (int q = 0; q < 4; q++) {
+        node.child[q] = -1;
+        if (children[q].begin == children[q].end) continue;
+        int32_t child = linkTopLevel(children[q], subtreeNodes, nextSubtree);
+        node.child[q] = child;
+        node.mu += nodes_[child].mu;
+        node.comX += nodes_[child].mu * nodes_[child].comX;
+        node.comY += nodes_[child].mu * nodes_[child].comY;
+    }
+    node.comX /= node.mu;
+    node.comY /= node.mu;
+    nodes_[index] = node;
+    return index;
+}
+
+void BarnesHutTree::accelerationAt(double px, double py, size_t self, double openingAngle, double softening,
+    double& ax, double& ay) const {
+    if (nodes_.empty()) return;
+    const double theta2 = openingAngle * openingAngle;
+    const double eps2 = softening * softening;
+
+    int32_t stack[TRAVERSAL_STACK];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes_[stack[--top]];
+        bool leaf = node.child[0] < 0 && node.child[1] < 0 && node.child[2] < 0 && node.child[3] < 0;
+
+        if (leaf) {
+            for (uint32_t k = node.first; k < node.first + node.count; k++) {
+                if (sourceIndex_[k] == self) continue;
+                double dx = sourceX_[k] - px;
+                double dy = sourceY_[k] - py;
+                double r2 = dx * dx + dy * dy + eps2;
+                double scale = sourceMu_[k] / (r2 * std::sqrt(r2));
+                ax += scale * dx;
+                ay += scale * dy;
+            }
+            continue;
+        }
+
+        double dx = node.comX - px;
+        double dy = node.comY - py;
+        double d2 = dx * dx + dy * dy;
+        double size = 2.0 * node.halfSize;
+        bool inside = std::fabs(px - node.centerX) <= node.halfSize && std::fabs(py - node.centerY) <= node.halfSize;
+        if (!inside && size * size < theta2 * d2) {
+            double r2 = d2 + eps2;
+            double scale = node.mu / (r2 * std::sqrt(r2));
+            ax += scale * dx;
+            ay += scale * dy;
+            continue;
+        }
+        for (int q = 0; q < 4; q++) {
+            if (node.child[q] >= 0) stack[top++] = node.child[q];
+        }
+    }
+}
@@ -0,0 +1,53 @@
+// BarnesHut.h : Barnes-Hut tree for O(N log N) gravitational accelerations.
+// The simulation is planar, so the tree is a quadtree over the orbital plane.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class BarnesHutTree {
+public:
+    // Function to rebuild the tree over every body with mu > 0 (mu = G * mass).
+    // Bodies with mu == 0 are test particles and never act as sources.
+    void build(const double* x, const double* y, const double* mu, size_t count);
+
+    // Function to accumulate the acceleration at (px, py) from all sources except
+    // body self (pass SIZE_MAX for a point that is not a body). Cells are used as a
+    // single mass when cellSize / distance < openingAngle.
+    void accelerationAt(double px, double py, size_t self, double openingAngle, double softening,
+        double& ax, double& ay) const;
+
+    size_t nodeCount() const { return nodes_.size(); }
+    size_t sourceCount() const { return sourceIndex_.size(); }
+
+private:
+    // Structure to hold one quadtree cell and its monopole moment
+    struct Node {
+        double comX, comY;          // Center of mass
+        double mu;                  // Total G * mass
+        double centerX, centerY;    // Geometric center of the cell
+        double halfSize;            // Half the cell's side length
+        int32_t child[4];           // Child node indices, -1 when empty
+        uint32_t first, count;      // Range of sources in Morton order (leaves only)
+    };
+
+    // Structure to hold a cell of the tree while it is being built
+    struct Cell {
+        size_t begin, end;          // Range of sources in Morton order
+        int level;
+        double centerX, centerY, halfSize;
+    };
+
+    int32_t buildNode(std::vector<Node>& nodes, const Cell& cell) const;
+    void collectSubtrees(const Cell& cell, std::vector<Cell>& subtrees) const;
+    int32_t linkTopLevel(const Cell& cell, std::vector<std::vector<Node>>& subtreeNodes, size_t& nextSubtree);
+    void childCells(const Cell& cell, Cell children[4]) const;
+
+    std::vector<Node> nodes_;
+    std::vector<uint64_t> keys_;          // Morton keys of sources, sorted
+    std::vector<uint32_t> sourceIndex_;   // Original body index of each sorted source
+    std::vector<double> sourceX_, sourceY_, sourceMu_;  // Source data in Morton order
+    double rootCenterX_ = 0.0, rootCenterY_ = 0.0, rootHalfSize_ = 0.0;
+};
@@ -0,0 +1,537 @@
+// BodyCatalog.cpp : Parallel text catalog parsing and the packed binary format.
+//
+#include "BodyCatalog.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Planets.h"
+#include "SolarSystemSimulation.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace {
+
+const float DEGREES_TO_RADIANS = 0.0174532925199f;
+const size_t MIN_CHUNK_BYTES = 1 << 16;   // Smallest slice of a text file handed to one thread
+const size_t CHUNKS_PER_WORKER = 4;       // Extra chunks so uneven line lengths still balance
+
+const char BINARY_MAGIC[4] = { 'S', 'S', 'B', 'C' };
+const uint32_t BINARY_VERSION = 1;
+const size_t BINARY_ALIGNMENT = 64;
+
+// Structure to hold the fixed header at the start of a binary catalog
+struct BinaryCatalogHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t nameBytes;
+};
+
+// Sections of a binary catalog, in file order
+enum BinarySection {
+    SECTION_SEMI_MAJOR, SECTION_SEMI_MINOR, SECTION_ECCENTRICITY, SECTION_MEAN_MOTION,
+    SECTION_MEAN_ANOMALY, SECTION_PERIAPSIS_COS, SECTION_PERIAPSIS_SIN,
+    SECTION_STYLES, SECTION_MASSES, SECTION_NAME_OFFSETS, SECTION_NAME_DATA, SECTION_COUNT
+};
+
+// Structure to hold one parsed catalog row before it is written into the arrays
+struct CatalogRecord {
+    float semiMajorAxis;        // AU
+    float eccentricity;
+    float meanAnomaly;          // Degrees
+    float longitudeOfNode;      // Degrees
+    float argumentOfPeriapsis;  // Degrees
+    const char* name;
+    size_t nameLength;
+};
+
+// Structure to hold column positions of a CSV catalog
+struct CsvColumns {
+    int name = -1, a = -1, e = -1, node = -1, periapsis = -1, meanAnomaly = -1;
+    int count = 0;
+};
+
+// Structure to hold the work and results of one parser thread
+struct ParseChunk {
+    const char* begin;
+    const char* end;
+    size_t lines = 0;       // Lines in the chunk (upper bound on rows)
+    size_t offset = 0;      // First slot this chunk writes to
+    size_t parsed = 0;      // Rows that parsed successfully
+    std::vector<char> names;
+    std::vector<uint32_t> nameStarts;
+};
+
+// Function to round offset up to the binary section alignment
+inline size_t alignUp(size_t offset) {
+    return (offset + BINARY_ALIGNMENT - 1) / BINARY_ALIGNMENT * BINARY_ALIGNMENT;
+}
+
+// Function to compute where every section of a binary catalog starts
+size_t binaryLayout(size_t count, size_t nameBytes, size_t offsets[SECTION_COUNT]) {
+    size_t sizes[SECTION_COUNT] = {};
+    for (int s = SECTION_SEMI_MAJOR; s <= SECTION_PERIAPSIS_SIN; s++) sizes[s] = count * sizeof(float);
+    sizes[SECTION_STYLES] = count * sizeof(BodyStyle);
+    sizes[SECTION_MASSES] = count * sizeof(float);
+    sizes[SECTION_NAME_OFFSETS] = count * sizeof(uint32_t);
+    sizes[SECTION_NAME_DATA] = nameBytes;
+
+    size_t cursor = alignUp(sizeof(BinaryCatalogHeader));
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        offsets[s] = cursor;
+        cursor = alignUp(cursor + sizes[s]);
+    }
+    return cursor;
+}
+
+// Function to trim spaces and quotes from [begin, end)
+void trimField(const char*& begin, const char*& end) {
+    while (begin < end && (*begin == ' ' || *begin == '"' || *begin == '\t')) begin++;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '"' || end[-1] == '\t' || end[-1] == '\r')) end--;
+}
+
+// Function to parse a float from a text field, ignoring surrounding spaces and quotes
+bool parseField(const char* begin, const char* end, float& value) {
+    trimField(begin, end);
+    if (begin == end) return false;
+    if (*begin == '+') begin++;
+    auto result = std::from_chars(begin, end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// Function to parse one fixed-column MPCORB.DAT row
+bool parseMpcLine(const char* line, size_t length, CatalogRecord& record) {
+    if (length < 103) return false;
+    if (!parseField(line + 26, line + 35, record.meanAnomaly)) return false;
+    if (!parseField(line + 37, line + 46, record.argumentOfPeriapsis)) return false;
+    if (!parseField(line + 48, line + 57, record.longitudeOfNode)) return false;
+    if (!parseField(line + 70, line + 79, record.eccentricity)) return false;
+    if (!parseField(line + 92, line + 103, record.semiMajorAxis)) return false;
+
+    // Prefer the readable designation (columns 167-194) over the packed one (1-7)
+    const char* nameBegin = line;
+    const char* nameEnd = line + 7;
+    if (length >= 175) {
+        nameBegin = line + 166;
+        nameEnd = line + std::min<size_t>(length, 194);
+    }
+    trimField(nameBegin, nameEnd);
+    record.name = nameBegin;
+    record.nameLength = static_cast<size_t>(nameEnd - nameBegin);
+    return true;
+}
+
+// Function to split a CSV line into at most maxFields fields; returns the field count
+int splitCsv(const char* line, size_t length, const char** begins, const char** ends, int maxFields) {
+    int count = 0;
+    const char* cursor = line;
+    const char* end = line + length;
+    while (count < maxFields) {
+        const char* fieldEnd = cursor;
+        bool quoted = false;
+        while (fieldEnd < end && (quoted || *fieldEnd != ',')) {
+            if (*fieldEnd == '"') quoted = !quoted;
+            fieldEnd++;
+        }
+        begins[count] = cursor;
+        ends[count] = fieldEnd;
+        count++;
+        if (fieldEnd >= end) break;
+        cursor = fieldEnd + 1;
+    }
+    return count;
+}
+
+const int MAX_CSV_FIELDS = 64;
+
+// Function to map SBDB header names to column positions
+bool parseCsvHeader(const char* line, size_t length, CsvColumns& columns) {
+    const char* begins[MAX_CSV_FIELDS];
+    const char* ends[MAX_CSV_FIELDS];
+    columns.count = splitCsv(line, length, begins, ends, MAX_CSV_FIELDS);
+    for (int c = 0; c < columns.count; c++) {
+        const char* begin = begins[c];
+        const char* end = ends[c];
+        trimField(begin, end);
+        std::string field(begin, end);
+        if (field == "full_name" || (field == "name" && columns.name < 0) || (field == "pdes" && columns.name < 0)) columns.name = c;
+        else if (field == "a") columns.a = c;
+        else if (field == "e") columns.e = c;
+        else if (field == "om") columns.node = c;
+        else if (field == "w") columns.periapsis = c;
+        else if (field == "ma") columns.meanAnomaly = c;
+    }
+    return columns.a >= 0 && columns.e >= 0 && columns.meanAnomaly >= 0;
+}
+
+// Function to parse one SBDB CSV row using the header's column map
+bool parseCsvLine(const char* line, size_t length, const CsvColumns& columns, CatalogRecord& record) {
+    const char* begins[MAX_CSV_FIELDS];
+    const char* ends[MAX_CSV_FIELDS];
+    int count = splitCsv(line, length, begins, ends, MAX_CSV_FIELDS);
+    if (count < columns.count) return false;
+    if (!parseField(begins[columns.a], ends[columns.a], record.semiMajorAxis)) return false;
+    if (!parseField(begins[columns.e], ends[columns.e], record.eccentricity)) return false;
+    if (!parseField(begins[columns.meanAnomaly], ends[columns.meanAnomaly], record.meanAnomaly)) return false;
+    record.longitudeOfNode = 0.0f;
+    record.argumentOfPeriapsis = 0.0f;
+    if (columns.node >= 0) parseField(begins[columns.node], ends[columns.node], record.longitudeOfNode);
+    if (columns.periapsis >= 0) parseField(begins[columns.periapsis], ends[columns.periapsis], record.argumentOfPeriapsis);
+
+    record.name = "";
+    record.nameLength = 0;
+    if (columns.name >= 0) {
+        const char* nameBegin = begins[columns.name];
+        const char* nameEnd = ends[columns.name];
+        trimField(nameBegin, nameEnd);
+        record.name = nameBegin;
+        record.nameLength = static_cast<size_t>(nameEnd - nameBegin);
+    }
+    return true;
+}
+
+// Function to find the end of the line starting at cursor (points at '\n' or end)
+inline const char* lineEnd(const char* cursor, const char* end) {
+    const void* newline = std::memchr(cursor, '\n', static_cast<size_t>(end - cursor));
+    return newline ? static_cast<const char*>(newline) : end;
+}
+
+// Function to store a parsed record in slot i. The catalog treats the file's
+// epoch as simulation time zero and projects orbits onto the ecliptic plane,
+// so inclination is not used.
+inline bool storeRecord(BodyCatalog& catalog, size_t i, const CatalogRecord& record) {
+    float a = record.semiMajorAxis;
+    float e = record.eccentricity;
+    if (!(a > 0.0f) || !(e >= 0.0f && e < 1.0f)) return false;
+
+    float longitudeOfPeriapsis = (record.longitudeOfNode + record.argumentOfPeriapsis) * DEGREES_TO_RADIANS;
+    float meanAnomaly = std::fmod(record.meanAnomaly * DEGREES_TO_RADIANS, TWO_PI);
+    if (meanAnomaly < 0.0f) meanAnomaly += TWO_PI;
+    // Kepler's third law in AU and years, then scaled to scene units like the planet table
+    catalog.elements.set(i, a * SCALE, e, a * std::sqrt(a), meanAnomaly, longitudeOfPeriapsis);
+    return true;
+}
+
+// Function to move rows [from, from + count) down to slot to, across every array
+void moveRows(BodyCatalog& catalog, size_t to, size_t from, size_t count) {
+    if (to == from || count == 0) return;
+    float* arrays[ELEMENT_ARRAY_COUNT];
+    catalog.elements.arrays(arrays);
+    for (float* array : arrays) std::memmove(array + to, array + from, count * sizeof(float));
+    std::memmove(catalog.styles.data() + to, catalog.styles.data() + from, count * sizeof(BodyStyle));
+}
+
+} // namespace
+
+void BodyCatalog::clear() {
+    elements.resize(0);
+    styles.clear();
+    masses.clear();
+    nameOffsets.clear();
+    nameData.assign(1, '\0');
+}
+
+size_t BodyCatalog::add(float a, float e, float orbitalPeriod, float meanAnomaly, float longitudeOfPeriapsis,
+    const char* bodyName, const BodyStyle& style, float mass) {
+    if (nameData.empty()) nameData.push_back('\0');
+    size_t i = elements.add(a, e, orbitalPeriod, meanAnomaly, longitudeOfPeriapsis);
+    styles.push_back(style);
+    masses.push_back(mass);
+    nameOffsets.push_back(static_cast<uint32_t>(nameData.size()));
+    nameData.insert(nameData.end(), bodyName, bodyName + std::strlen(bodyName) + 1);
+    return i;
+}
+
+bool parseTextCatalog(const char* data, size_t size, CatalogFormat format, const CatalogLoadOptions& options,
+    BodyCatalog& catalog, std::string& error) {
+    catalog.clear();
+    const char* end = data + size;
+    const char* cursor = data;
+
+    // Skip the header: everything up to a dashed separator for MPC, the column row for CSV
+    CsvColumns columns;
+    if (format == CatalogFormat::SbdbCsv) {
+        const char* headerEnd = lineEnd(cursor, end);
+        if (!parseCsvHeader(cursor, static_cast<size_t>(headerEnd - cursor), columns)) {
+            error = "CSV header must name the a, e and ma columns";
+            return false;
+        }
+        cursor = headerEnd < end ? headerEnd + 1 : end;
+    } else {
+        const char* probe = cursor;
+        const char* probeEnd = data + std::min<size_t>(size, MIN_CHUNK_BYTES);
+        while (probe < probeEnd) {
+            const char* next = lineEnd(probe, end);
+            if (next - probe >= 5 && std::strncmp(probe, "-----", 5) == 0) {
+                cursor = next < end ? next + 1 : end;
+                break;
+            }
+            if (next == end) break;
+            probe = next + 1;
+        }
+    }
+
+    // Cut the body into line-aligned chunks for the worker threads
+    size_t bodyBytes = static_cast<size_t>(end - cursor);
+    size_t chunkCount = std::max<size_t>(1, std::min(workerCount() * CHUNKS_PER_WORKER, bodyBytes / MIN_CHUNK_BYTES));
+    std::vector<ParseChunk> chunks(chunkCount);
+    const char* chunkBegin = cursor;
+    for (size_t c = 0; c < chunkCount; c++) {
+        const char* chunkEnd = c + 1 == chunkCount ? end : cursor + bodyBytes * (c + 1) / chunkCount;
+        if (chunkEnd < chunkBegin) chunkEnd = chunkBegin;
+        if (chunkEnd < end) {
+            chunkEnd = lineEnd(chunkEnd, end);
+            if (chunkEnd < end) chunkEnd++;
+        }
+        chunks[c].begin = chunkBegin;
+        chunks[c].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    // Pass 1: count lines so every chunk knows where its rows land
+    parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; c++) {
+            size_t lines = 0;
+            const char* line = chunks[c].begin;
+            while (line < chunks[c].end) {
+                const char* next = lineEnd(line, chunks[c].end);
+                lines++;
+                if (next == chunks[c].end) break;
+                line = next + 1;
+            }
+            chunks[c].lines = lines;
+        }
+    });
+    size_t capacity = 0;
+    for (ParseChunk& chunk : chunks) {
+        chunk.offset = capacity;
+        capacity += chunk.lines;
+    }
+    catalog.elements.resize(capacity);
+    catalog.styles.assign(capacity, options.defaultStyle);
+
+    // Pass 2: parse straight into the element arrays; names collect per chunk
+    parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; c++) {
+            ParseChunk& chunk = chunks[c];
+            CatalogRecord record;
+            for (const char* line = chunk.begin; line < chunk.end;) {
+                const char* next = lineEnd(line, chunk.end);
+                size_t length = static_cast<size_t>(next - line);
+                bool parsed = format == CatalogFormat::SbdbCsv ? parseCsvLine(line, length, columns, record)
+                    : parseMpcLine(line, length, record);
+                if (parsed && storeRecord(catalog, chunk.offset + chunk.parsed, record)) {
+                    if (options.loadNames) {
+                        chunk.nameStarts.push_back(static_cast<uint32_t>(chunk.names.size()));
+                        chunk.names.insert(chunk.names.end(), record.name, record.name + record.nameLength);
+                        chunk.names.push_back('\0');
+                    }
+                    chunk.parsed++;
+                }
+                if (next == chunk.end) break;
+                line = next + 1;
+            }
+        }
+    });
+
+    // Close the gaps left by rejected lines and stitch the name tables together
+    size_t count = 0;
+    for (ParseChunk& chunk : chunks) {
+        moveRows(catalog, count, chunk.offset, chunk.parsed);
+        uint32_t base = static_cast<uint32_t>(catalog.nameData.size());
+        catalog.nameData.insert(catalog.nameData.end(), chunk.names.begin(), chunk.names.end());
+        for (size_t k = 0; k < chunk.parsed; k++) {
+            catalog.nameOffsets.push_back(options.loadNames ? base + chunk.nameStarts[k] : 0);
+        }
+        count += chunk.parsed;
+    }
+    catalog.elements.resize(count);
+    catalog.styles.resize(count);
+    catalog.masses.assign(count, 0.0f);
+
+    if (count == 0) {
+        error = "no valid orbital element rows found";
+        return false;
+    }
+    return true;
+}
+
+bool loadCatalog(const std::string& path, BodyCatalog& catalog, const CatalogLoadOptions& options, std::string& error) {
+    MappedFile file;
+    if (!file.open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    const char* data = file.data();
+    size_t size = file.size();
+
+    CatalogFormat format = options.format;
+    if (format == CatalogFormat::Auto) {
+        bool extensionCsv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        if (size >= sizeof(BINARY_MAGIC) && std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) format = CatalogFormat::Binary;
+        else if (extensionCsv) format = CatalogFormat::SbdbCsv;
+        else format = CatalogFormat::MpcOrb;
+    }
+    if (format != CatalogFormat::Binary) {
+        return parseTextCatalog(data, size, format, options, catalog, error);
+    }
+
+    BinaryCatalogHeader header;
+    if (size < sizeof(header)) {
+        error = path + " is too small to be a binary catalog";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 || header.version != BINARY_VERSION) {
+        error = path + " is not a version " + std::to_string(BINARY_VERSION) + " binary catalog";
+        return false;
+    }
+    // Bound the header's counts by the file size first, so the layout sums below cannot overflow
+    if (header.count > size / sizeof(float) || header.nameBytes > size) {
+        error = path + " is truncated";
+        return false;
+    }
+    size_t offsets[SECTION_COUNT];
+    size_t count = static_cast<size_t>(header.count);
+    size_t nameBytes = static_cast<size_t>(header.nameBytes);
+    if (binaryLayout(count, nameBytes, offsets) > size) {
+        error = path + " is truncated";
+        return false;
+    }
+
+    // Every name must start inside the name data, which must end in a terminator.
+    // Offsets only grow, except for 0, the empty name unnamed bodies share.
+    const char* nameData = data + offsets[SECTION_NAME_DATA];
+    if (count > 0 && (nameBytes == 0 || nameData[nameBytes - 1] != '\0')) {
+        error = path + " has unterminated name data";
+        return false;
+    }
+    uint32_t lastOffset = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t offset;
+        std::memcpy(&offset, data + offsets[SECTION_NAME_OFFSETS] + i * sizeof(uint32_t), sizeof(offset));
+        if (offset == 0) continue;
+        if (offset >= nameBytes || offset < lastOffset) {
+            error = path + " has a bad name offset for body " + std::to_string(i);
+            return false;
+        }
+        lastOffset = offset;
+    }
+
+    // Every section is already in its in-memory layout, so loading is a straight copy
+    catalog.elements.resize(count);
+    catalog.styles.resize(count);
+    catalog.masses.resize(count);
+    catalog.nameOffsets.resize(count);
+    catalog.nameData.resize(nameBytes);
+    float* arrays[ELEMENT_ARRAY_COUNT];
+    catalog.elements.arrays(arrays);
+    parallelFor(0, ELEMENT_ARRAY_COUNT, 1, [&](size_t first, size_t last) {
+        for (size_t s = first; s < last; s++) std::memcpy(arrays[s], data + offsets[s], count * sizeof(float));
+    });
+    // The same ranges the text parsers accept, so a bad file cannot turn into NaN positions
+    const OrbitalElements& elements = catalog.elements;
+    for (size_t i = 0; i < count; i++) {
+        float e = elements.eccentricity[i];
+        if (!(elements.semiMajorAxis[i] > 0.0f) || !(e >= 0.0f && e < 1.0f) || !std::isfinite(elements.semiMajorAxis[i]) ||
+            !std::isfinite(elements.semiMinorAxis[i]) || !std::isfinite(elements.meanMotion[i]) ||
+            !std::isfinite(elements.meanAnomaly[i]) || !std::isfinite(elements.periapsisCos[i]) ||
+            !std::isfinite(elements.periapsisSin[i])) {
+            error = path + " has bad orbital elements for body " + std::to_string(i);
+            catalog.clear();
+            return false;
+        }
+    }
+    std::memcpy(catalog.styles.data(), data + offsets[SECTION_STYLES], count * sizeof(BodyStyle));
+    std::memcpy(catalog.masses.data(), data + offsets[SECTION_MASSES], count * sizeof(float));
+    std::memcpy(catalog.nameOffsets.data(), data + offsets[SECTION_NAME_OFFSETS], count * sizeof(uint32_t));
+    std::memcpy(catalog.nameData.data(), data + offsets[SECTION_NAME_DATA], catalog.nameData.size());
+    if (catalog.nameData.empty() || catalog.nameData.back() != '\0') catalog.nameData.push_back('\0');
+    return true;
+}
+
+bool writeBinaryCatalog(const std::string& path, const BodyCatalog& catalog, std::string& error) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot create " + path;
+        return false;
+    }
+
+    size_t count = catalog.size();
+    BinaryCatalogHeader header = {};
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.count = count;
+    header.nameBytes = catalog.nameData.size();
+    size_t offsets[SECTION_COUNT];
+    size_t total = binaryLayout(count, catalog.nameData.size(), offsets);
+
+    const void* sections[SECTION_COUNT];
+    size_t sizes[SECTION_COUNT];
+    const float* arrays[ELEMENT_ARRAY_COUNT];
+    catalog.elements.arrays(arrays);
+    for (int s = SECTION_SEMI_MAJOR; s <= SECTION_PERIAPSIS_SIN; s++) {
+        sections[s] = arrays[s];
+        sizes[s] = count * sizeof(float);
+    }
+    sections[SECTION_STYLES] = catalog.styles.data();
+    sizes[SECTION_STYLES] = count * sizeof(BodyStyle);
+    sections[SECTION_MASSES] = catalog.masses.data();
+    sizes[SECTION_MASSES] = count * sizeof(float);
+    sections[SECTION_NAME_OFFSETS] = catalog.nameOffsets.data();
+    sizes[SECTION_NAME_OFFSETS] = count * sizeof(uint32_t);
+    sections[SECTION_NAME_DATA] = catalog.nameData.data();
+    sizes[SECTION_NAME_DATA] = catalog.nameData.size();
+
+    // Sections are written in order with zero padding up to each aligned offset
+    const char padding[BINARY_ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    size_t written = sizeof(header);
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        out.write(padding, static_cast<std::streamsize>(offsets[s] - written));
+        out.write(static_cast<const char*>(sections[s]), static_cast<std::streamsize>(sizes[s]));
+        written = offsets[s] + sizes[s];
+    }
+    out.write(padding, static_cast<std::streamsize>(total - written));
+
+    if (!out) {
+        error = "failed writing " + path;
+        return false;
+    }
+    return true;
+}
+
+void makeDefaultCatalog(BodyCatalog& catalog, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> anomaly(0.0f, TWO_PI);
+
+    catalog.clear();
+    for (const Planet& planet : planets) {
+        BodyStyle style = { planet.size, planet.r, planet.g, planet.b, STYLE_DRAW_ORBIT };
+        catalog.add(planet.semiMajorAxis, planet.eccentricity, planet.orbitalPeriod, anomaly(rng), 0.0f,
+            planet.name, style, planet.mass);
+    }
+}
+
+void addAsteroidBelt(BodyCatalog& catalog, size_t count, unsigned int seed, float mass) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> axis(2.1f, 3.3f);
+    std::uniform_real_distribution<float> eccentricity(0.0f, 0.3f);
+    std::uniform_real_distribution<float> angle(0.0f, TWO_PI);
+    const BodyStyle style = CatalogLoadOptions().defaultStyle;
+
+    if (catalog.nameData.empty()) catalog.nameData.push_back('\0');
+    size_t first = catalog.size();
+    catalog.elements.resize(first + count);
+    for (size_t i = first; i < first + count; i++) {
+        float a = axis(rng);
+        // Kepler's third law in AU and years, then scaled to scene units like the planet table
+        catalog.elements.set(i, a * SCALE, eccentricity(rng), std::pow(a, 1.5f), angle(rng), angle(rng));
+    }
+    catalog.styles.resize(first + count, style);
+    catalog.masses.resize(first + count, mass);
+    catalog.nameOffsets.resize(first + count, 0);
+}
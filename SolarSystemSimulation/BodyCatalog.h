@@ -0,0 +1,74 @@
+// BodyCatalog.h : Body catalogs loaded from MPC / JPL text files or a packed
+// binary format. Orbital elements go straight into OrbitalElements; names,
+// colors and masses live in side tables off the propagation path.
+
+#pragma once
+
+#include "OrbitalElements.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Style flags
+const uint32_t STYLE_DRAW_ORBIT = 1u << 0;  // Draw the body's orbit ellipse
+
+// Structure to hold how a body is drawn
+struct BodyStyle {
+    float size;      // Visual radius in scene units
+    float r, g, b;   // Color
+    uint32_t flags;  // STYLE_* bits
+};
+
+// Structure to hold a catalog: elements plus per-body side tables, all indexed alike
+struct BodyCatalog {
+    OrbitalElements elements;
+    std::vector<BodyStyle> styles;
+    std::vector<float> masses;          // Solar masses; 0 for test particles
+    std::vector<uint32_t> nameOffsets;  // Offset of each body's name in nameData
+    std::vector<char> nameData;         // NUL-terminated names; offset 0 is the empty name
+
+    size_t size() const { return elements.size(); }
+    const char* name(size_t i) const { return &nameData[nameOffsets[i]]; }
+
+    void clear();
+
+    // Function to append one body and return its index
+    size_t add(float a, float e, float orbitalPeriod, float meanAnomaly, float longitudeOfPeriapsis,
+        const char* bodyName, const BodyStyle& style, float mass);
+};
+
+// Supported on-disk formats
+enum class CatalogFormat {
+    Auto,       // Pick from the file header and extension
+    MpcOrb,     // MPCORB.DAT fixed-column export
+    SbdbCsv,    // JPL small-body database CSV with a header row (full_name,a,e,om,w,ma,...)
+    Binary      // Packed SSBC file written by writeBinaryCatalog
+};
+
+// Structure to hold loader options
+struct CatalogLoadOptions {
+    CatalogFormat format = CatalogFormat::Auto;
+    bool loadNames = true;                  // Skip the name side table to save memory
+    BodyStyle defaultStyle = { 0.005f, 0.6f, 0.6f, 0.6f, 0 };
+};
+
+// Function to load a catalog file, replacing the catalog's contents. Text files
+// are memory-mapped and parsed by several threads straight into the element
+// arrays. Returns false and fills error on failure.
+bool loadCatalog(const std::string& path, BodyCatalog& catalog, const CatalogLoadOptions& options, std::string& error);
+
+// Function to parse a text catalog that is already in memory
+bool parseTextCatalog(const char* data, size_t size, CatalogFormat format, const CatalogLoadOptions& options,
+    BodyCatalog& catalog, std::string& error);
+
+// Function to write the packed binary format that loadCatalog maps back in one pass
+bool writeBinaryCatalog(const std::string& path, const BodyCatalog& catalog, std::string& error);
+
+// Function to fill the catalog with the built-in planets, using random mean
+// anomalies to avoid straight-line alignment
+void makeDefaultCatalog(BodyCatalog& catalog, unsigned int seed);
+
+// Function to append count synthetic main-belt asteroids (2.1 - 3.3 AU) for stress runs.
+// Each gets mass solar masses; at 0 they are test particles in N-body mode.
+void addAsteroidBelt(BodyCatalog& catalog, size_t count, unsigned int seed, float mass = 0.0f);
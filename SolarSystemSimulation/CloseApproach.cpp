@@ -0,0 +1,377 @@
+// CloseApproach.cpp : Grid broad phase and closest-approach narrow phase.
+//
+#include "CloseApproach.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <mutex>
+#include <numeric>
+
+namespace {
+
+// Grid levels; each doubles the cell size so fast bodies still fit one cell
+const int GRID_LEVELS = 16;
+
+// Cell coordinates are biased by CELL_OFFSET and packed 30 bits each, below a 4-bit level
+const int CELL_BITS = 30;
+const int64_t CELL_MASK = (int64_t(1) << CELL_BITS) - 1;
+const int64_t CELL_OFFSET = int64_t(1) << (CELL_BITS - 1);
+
+// Bodies per task when computing swept circles and keys, and cells per screening task
+const size_t BODY_GRAIN = 65536;
+const size_t CELL_GRAIN = 1024;
+
+// The grid is patched in place while fewer than 1 / INCREMENTAL_FRACTION of
+// the bodies change cell, and sorted from scratch otherwise
+const size_t INCREMENTAL_FRACTION = 2;
+
+// Bodies sampled, and the fraction of them that fit the finest level, when sizing cells
+const size_t CELL_SIZE_SAMPLES = 65536;
+const float CELL_SIZE_QUANTILE = 0.9f;
+
+// Float screening passes pairs slightly beyond the threshold; double precision decides
+const float SCREEN_SLACK = 1.001f;
+
+inline uint64_t packKey(int level, int64_t cx, int64_t cy) {
+    return (static_cast<uint64_t>(level) << (2 * CELL_BITS)) | (static_cast<uint64_t>(cy) << CELL_BITS) | static_cast<uint64_t>(cx);
+}
+
+inline int keyLevel(uint64_t key) { return static_cast<int>(key >> (2 * CELL_BITS)); }
+inline int64_t keyX(uint64_t key) { return static_cast<int64_t>(key & CELL_MASK); }
+inline int64_t keyY(uint64_t key) { return static_cast<int64_t>((key >> CELL_BITS) & CELL_MASK); }
+
+// Function to return the biased cell coordinate of v for the given cell size
+inline int64_t cellCoordinate(float v, double size) {
+    double c = std::floor(static_cast<double>(v) / size) + static_cast<double>(CELL_OFFSET);
+    return static_cast<int64_t>(std::clamp(c, 0.0, static_cast<double>(CELL_MASK)));
+}
+
+// Function to return the first cell, `levels` levels finer, inside the cell at
+// biased coordinate c; each cell covers 2^levels finer cells per axis
+inline int64_t finerCoordinate(int64_t c, int levels) {
+    return (c - CELL_OFFSET) * (int64_t(1) << levels) + CELL_OFFSET;
+}
+
+// Function to sort ids by keys[id], keeping equal keys in their input order.
+// A least-significant-digit radix sort that skips the bytes every key shares,
+// which with a compact grid leaves only a few passes.
+void sortByKey(std::vector<uint32_t>& ids, const std::vector<uint64_t>& keys,
+    std::vector<std::pair<uint64_t, uint32_t>>& items, std::vector<std::pair<uint64_t, uint32_t>>& scratch) {
+    if (ids.size() < 2) return;
+    items.resize(ids.size());
+    scratch.resize(ids.size());
+    uint64_t differing = 0;
+    for (size_t k = 0; k < ids.size(); k++) {
+        items[k] = std::make_pair(keys[ids[k]], ids[k]);
+        differing |= items[k].first ^ items[0].first;
+    }
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((differing >> shift) & 0xFF) == 0) continue;
+        size_t offsets[257] = {};
+        for (const auto& item : items) offsets[((item.first >> shift) & 0xFF) + 1]++;
+        for (int b = 0; b < 256; b++) offsets[b + 1] += offsets[b];
+        for (const auto& item : items) scratch[offsets[(item.first >> shift) & 0xFF]++] = item;
+        items.swap(scratch);
+    }
+    for (size_t k = 0; k < ids.size(); k++) ids[k] = items[k].second;
+}
+
+// Function to order events by time, then by pair
+bool eventBefore(const CloseApproachEvent& a, const CloseApproachEvent& b) {
+    if (a.time != b.time) return a.time < b.time;
+    return a.first != b.first ? a.first < b.first : a.second < b.second;
+}
+
+} // namespace
+
+CloseApproachDetector::CloseApproachDetector(const CloseApproachSettings& settings)
+    : settings_(settings), cellSize_(settings.cellSize), previousTime_(0.0), currentTime_(0.0),
+    current_(nullptr), levelMask_(0), updates_(0) {}
+
+void CloseApproachDetector::reset() {
+    cellSize_ = settings_.cellSize;
+    previousX_.clear();
+    previousY_.clear();
+    keys_.clear();
+    order_.clear();
+    cells_.clear();
+    active_.clear();
+    stats_ = CloseApproachStats();
+}
+
+void CloseApproachDetector::update(const BodyPositions& positions, double time, std::vector<CloseApproachEvent>& events) {
+    size_t count = positions.size();
+    stats_ = CloseApproachStats();
+    if (previousX_.size() != count) {
+        // Nothing to compare against yet; this sample starts the first step
+        reset();
+        previousX_ = positions.x;
+        previousY_ = positions.y;
+        previousTime_ = time;
+        return;
+    }
+    current_ = &positions;
+    currentTime_ = time;
+    updates_++;
+
+    // Broad phase: swept circles into the grid, patched for the bodies that changed cell
+    {
+        ScopedTimer timer("approach grid");
+        sweep();
+        if (cellSize_ <= 0.0f) chooseCellSize();
+        size_t moved = updateKeys();
+        sortBodies(moved);
+        collectCells();
+    }
+
+    // Narrow phase over neighboring cells, then fold the hits into open encounters
+    std::vector<CloseApproachEvent> hits;
+    {
+        ScopedTimer timer("approach screen");
+        screenCells(hits);
+    }
+    for (const CloseApproachEvent& hit : hits) {
+        uint64_t pair = (static_cast<uint64_t>(hit.first) << 32) | hit.second;
+        auto found = active_.find(pair);
+        if (found == active_.end()) {
+            active_.emplace(pair, Encounter{ hit, updates_ });
+        } else {
+            if (hit.distance < found->second.closest.distance) found->second.closest = hit;
+            found->second.lastSeen = updates_;
+        }
+    }
+
+    // An encounter is over once the pair is no longer under the threshold
+    size_t firstEvent = events.size();
+    for (auto it = active_.begin(); it != active_.end();) {
+        if (it->second.lastSeen != updates_) {
+            events.push_back(it->second.closest);
+            it = active_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    std::sort(events.begin() + firstEvent, events.end(), eventBefore);
+    stats_.activeEncounters = active_.size();
+
+    previousX_.assign(positions.x.begin(), positions.x.end());
+    previousY_.assign(positions.y.begin(), positions.y.end());
+    previousTime_ = time;
+    current_ = nullptr;
+}
+
+void CloseApproachDetector::flush(std::vector<CloseApproachEvent>& events) {
+    size_t firstEvent = events.size();
+    for (const auto& entry : active_) events.push_back(entry.second.closest);
+    active_.clear();
+    std::sort(events.begin() + firstEvent, events.end(), eventBefore);
+}
+
+void CloseApproachDetector::sweep() {
+    size_t count = current_->size();
+    midX_.resize(count);
+    midY_.resize(count);
+    radius_.resize(count);
+    parallelFor(0, count, BODY_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float dx = current_->x[i] - previousX_[i];
+            float dy = current_->y[i] - previousY_[i];
+            midX_[i] = previousX_[i] + 0.5f * dx;
+            midY_[i] = previousY_[i] + 0.5f * dy;
+            radius_[i] = 0.5f * std::sqrt(dx * dx + dy * dy);
+        }
+    });
+}
+
+void CloseApproachDetector::chooseCellSize() {
+    // Sized so most bodies land on the finest level, where a 3x3 block of cells
+    // holds every body they can reach within the step
+    size_t count = radius_.size();
+    size_t stride = std::max<size_t>(1, count / CELL_SIZE_SAMPLES);
+    std::vector<float> sample;
+    for (size_t i = 0; i < count; i += stride) sample.push_back(radius_[i]);
+    float typical = 0.0f;
+    if (!sample.empty()) {
+        auto quantile = sample.begin() + static_cast<ptrdiff_t>(CELL_SIZE_QUANTILE * static_cast<float>(sample.size() - 1));
+        std::nth_element(sample.begin(), quantile, sample.end());
+        typical = *quantile;
+    }
+    cellSize_ = std::max(settings_.threshold + 2.0f * typical, 1e-6f);
+}
+
+size_t CloseApproachDetector::updateKeys() {
+    size_t count = radius_.size();
+    newKeys_.resize(count);
+    bool compare = keys_.size() == count;
+    return parallelReduce(0, count, BODY_GRAIN, size_t(0),
+        [&](size_t begin, size_t end) {
+            size_t moved = 0;
+            for (size_t i = begin; i < end; i++) {
+                // The finest level whose cells are at least as wide as the circle plus the threshold
+                float reach = 2.0f * radius_[i] + settings_.threshold;
+                double size = cellSize_;
+                int level = 0;
+                while (size < reach && level < GRID_LEVELS - 1) {
+                    size *= 2.0;
+                    level++;
+                }
+                uint64_t key = packKey(level, cellCoordinate(midX_[i], size), cellCoordinate(midY_[i], size));
+                newKeys_[i] = key;
+                if (!compare || keys_[i] != key) moved++;
+            }
+            return moved;
+        },
+        [](size_t a, size_t b) { return a + b; });
+}
+
+void CloseApproachDetector::sortBodies(size_t moved) {
+    size_t count = newKeys_.size();
+    stats_.movedBodies = moved;
+    stats_.rebuilt = order_.size() != count || moved > count / INCREMENTAL_FRACTION;
+    if (stats_.rebuilt) {
+        order_.resize(count);
+        std::iota(order_.begin(), order_.end(), 0u);
+        sortByKey(order_, newKeys_, sortItems_, sortScratch_);
+    } else {
+        // Bodies that kept their cell are still in order; sort the movers and merge them back in
+        staying_.clear();
+        moving_.clear();
+        for (uint32_t i : order_) {
+            if (keys_[i] == newKeys_[i]) staying_.push_back(i);
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (keys_[i] != newKeys_[i]) moving_.push_back(i);
+        }
+        sortByKey(moving_, newKeys_, sortItems_, sortScratch_);
+        std::merge(staying_.begin(), staying_.end(), moving_.begin(), moving_.end(), order_.begin(),
+            [&](uint32_t a, uint32_t b) { return newKeys_[a] != newKeys_[b] ? newKeys_[a] < newKeys_[b] : a < b; });
+    }
+    keys_.swap(newKeys_);
+}
+
+void CloseApproachDetector::collectCells() {
+    // Bodies are copied into cell order so screening streams through memory
+    swept_.resize(order_.size());
+    parallelFor(0, order_.size(), BODY_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+            uint32_t i = order_[k];
+            swept_[k] = { previousX_[i], previousY_[i], current_->x[i] - previousX_[i], current_->y[i] - previousY_[i], i };
+        }
+    });
+
+    cells_.clear();
+    levelMask_ = 0;
+    for (uint32_t k = 0; k < order_.size(); k++) {
+        uint64_t key = keys_[order_[k]];
+        if (cells_.empty() || cells_.back().key != key) {
+            cells_.push_back({ key, k, k });
+            levelMask_ |= 1u << keyLevel(key);
+        }
+        cells_.back().end = k + 1;
+    }
+    stats_.occupiedCells = cells_.size();
+}
+
+size_t CloseApproachDetector::firstCellFrom(uint64_t key) const {
+    auto found = std::lower_bound(cells_.begin(), cells_.end(), key, [](const Cell& cell, uint64_t k) { return cell.key < k; });
+    return static_cast<size_t>(found - cells_.begin());
+}
+
+void CloseApproachDetector::screenCells(std::vector<CloseApproachEvent>& hits) {
+    std::mutex hitsMutex;
+    std::atomic<size_t> candidates(0);
+    parallelFor(0, cells_.size(), CELL_GRAIN, [&](size_t firstCell, size_t lastCell) {
+        std::vector<CloseApproachEvent> local;
+        size_t localCandidates = 0;
+        auto testCells = [&](const Cell& a, const Cell& b) {
+            localCandidates += static_cast<size_t>(a.end - a.begin) * (b.end - b.begin);
+            for (uint32_t p = a.begin; p < a.end; p++) {
+                for (uint32_t q = b.begin; q < b.end; q++) testPair(swept_[p], swept_[q], local);
+            }
+        };
+        // Cells of one level and row with x in [minX, maxX] are adjacent in key order
+        auto testRow = [&](const Cell& cell, int level, int64_t minX, int64_t maxX, int64_t cy) {
+            if (cy < 0 || cy > CELL_MASK) return;
+            uint64_t last = packKey(level, std::min(maxX, CELL_MASK), cy);
+            for (size_t other = firstCellFrom(packKey(level, std::max<int64_t>(minX, 0), cy));
+                other < cells_.size() && cells_[other].key <= last; other++) {
+                testCells(cell, cells_[other]);
+            }
+        };
+
+        for (size_t c = firstCell; c < lastCell; c++) {
+            const Cell& cell = cells_[c];
+            int level = keyLevel(cell.key);
+            int64_t cx = keyX(cell.key), cy = keyY(cell.key);
+
+            // Pairs inside the cell, then half the 3x3 block so each neighbor pair is tested once
+            size_t inside = cell.end - cell.begin;
+            localCandidates += inside * (inside - 1) / 2;
+            for (uint32_t p = cell.begin; p < cell.end; p++) {
+                for (uint32_t q = p + 1; q < cell.end; q++) testPair(swept_[p], swept_[q], local);
+            }
+            if (c + 1 < cells_.size() && cx < CELL_MASK && cells_[c + 1].key == packKey(level, cx + 1, cy)) {
+                testCells(cell, cells_[c + 1]);
+            }
+            testRow(cell, level, cx - 1, cx + 1, cy + 1);
+
+            // Finer levels are searched from the coarse side, where bodies are few:
+            // every fine cell under the 3x3 block around this one
+            for (int fine = 0; fine < level; fine++) {
+                if (!(levelMask_ & (1u << fine))) continue;
+                int64_t minX = finerCoordinate(cx - 1, level - fine), maxX = finerCoordinate(cx + 2, level - fine) - 1;
+                int64_t minY = finerCoordinate(cy - 1, level - fine), maxY = finerCoordinate(cy + 2, level - fine) - 1;
+                for (int64_t row = std::max<int64_t>(minY, 0); row <= std::min(maxY, CELL_MASK); row++) {
+                    testRow(cell, fine, minX, maxX, row);
+                }
+            }
+        }
+
+        candidates += localCandidates;
+        if (!local.empty()) {
+            std::lock_guard<std::mutex> lock(hitsMutex);
+            hits.insert(hits.end(), local.begin(), local.end());
+        }
+    });
+
+    // Tasks finish in any order; sorting keeps the output independent of scheduling
+    std::sort(hits.begin(), hits.end(), [](const CloseApproachEvent& a, const CloseApproachEvent& b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    });
+    stats_.candidatePairs = candidates;
+}
+
+void CloseApproachDetector::testPair(const SweptBody& a, const SweptBody& b, std::vector<CloseApproachEvent>& hits) const {
+    // Separation is linear in time between the samples. Screen its minimum over
+    // the step in float, with a little slack for rounding
+    float startX = b.startX - a.startX, startY = b.startY - a.startY;
+    float moveX = b.moveX - a.moveX, moveY = b.moveY - a.moveY;
+    float moveSquared = moveX * moveX + moveY * moveY;
+    // min / max rather than branches: whether the minimum falls inside the step is a coin toss per pair
+    float fraction = std::min(std::max(-(startX * moveX + startY * moveY) / std::max(moveSquared, FLT_MIN), 0.0f), 1.0f);
+    float closestX = startX + fraction * moveX, closestY = startY + fraction * moveY;
+    float screen = settings_.threshold * SCREEN_SLACK;
+    if (closestX * closestX + closestY * closestY >= screen * screen) return;
+
+    // Then solve it again in double from the stored samples
+    uint32_t i = std::min(a.id, b.id), j = std::max(a.id, b.id);
+    double startXd = static_cast<double>(previousX_[j]) - previousX_[i];
+    double startYd = static_cast<double>(previousY_[j]) - previousY_[i];
+    double moveXd = (static_cast<double>(current_->x[j]) - previousX_[j]) - (static_cast<double>(current_->x[i]) - previousX_[i]);
+    double moveYd = (static_cast<double>(current_->y[j]) - previousY_[j]) - (static_cast<double>(current_->y[i]) - previousY_[i]);
+    double moveSquaredd = moveXd * moveXd + moveYd * moveYd;
+    double fractiond = moveSquaredd > 0.0 ? std::clamp(-(startXd * moveXd + startYd * moveYd) / moveSquaredd, 0.0, 1.0) : 0.0;
+    double distanceX = startXd + fractiond * moveXd, distanceY = startYd + fractiond * moveYd;
+    double distance = std::sqrt(distanceX * distanceX + distanceY * distanceY);
+    if (distance < settings_.threshold) {
+        CloseApproachEvent event;
+        event.first = i;
+        event.second = j;
+        event.time = previousTime_ + fractiond * (currentTime_ - previousTime_);
+        event.distance = static_cast<float>(distance);
+        hits.push_back(event);
+    }
+}
@@ -0,0 +1,109 @@
+// CloseApproach.h : Per-step close-approach screening. A uniform grid over the
+// bodies' swept positions finds candidate pairs in near-linear time, and a
+// narrow phase solves for the closest approach between the two step samples.
+
+#pragma once
+
+#include "OrbitalElements.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Structure to hold screening parameters
+struct CloseApproachSettings {
+    float threshold = 0.001f;   // Report pairs that come closer than this, in scene units
+    float cellSize = 0.0f;      // Grid cell edge; 0 sizes it from the first step's motion
+};
+
+// Structure to hold one encounter, reported once it is over
+struct CloseApproachEvent {
+    uint32_t first, second;     // Body indices, first < second
+    double time;                // Simulated years at closest approach
+    float distance;             // Separation at closest approach
+};
+
+// Structure to hold what the last update cost
+struct CloseApproachStats {
+    size_t movedBodies = 0;     // Bodies that changed grid cell
+    size_t occupiedCells = 0;
+    size_t candidatePairs = 0;  // Pairs close enough in the grid to be tested
+    size_t activeEncounters = 0;
+    bool rebuilt = false;       // The grid was sorted from scratch rather than patched
+};
+
+class CloseApproachDetector {
+public:
+    explicit CloseApproachDetector(const CloseApproachSettings& settings = CloseApproachSettings());
+
+    // Function to screen the motion since the previous call, with bodies moving
+    // in straight lines between the two samples. The first call, and any call
+    // after reset() or a change in body count, only records the positions.
+    // Encounters that ended during this step are appended to events, ordered by time.
+    void update(const BodyPositions& positions, double time, std::vector<CloseApproachEvent>& events);
+
+    // Function to report the encounters still in progress, e.g. at the end of a run
+    void flush(std::vector<CloseApproachEvent>& events);
+
+    // Function to forget the grid, the previous positions and any open encounters
+    void reset();
+
+    const CloseApproachSettings& settings() const { return settings_; }
+    const CloseApproachStats& stats() const { return stats_; }
+    float cellSize() const { return cellSize_; }
+
+private:
+    // Structure to hold a run of bodies in order_ that share a grid cell
+    struct Cell {
+        uint64_t key;
+        uint32_t begin, end;
+    };
+
+    // Structure to hold a body's step, stored in cell order for screening
+    struct SweptBody {
+        float startX, startY;
+        float moveX, moveY;
+        uint32_t id;
+    };
+
+    // Structure to hold an encounter in progress
+    struct Encounter {
+        CloseApproachEvent closest;
+        uint64_t lastSeen;          // Update that last found the pair under the threshold
+    };
+
+    void sweep();
+    void chooseCellSize();
+    size_t updateKeys();
+    void sortBodies(size_t moved);
+    void collectCells();
+    size_t firstCellFrom(uint64_t key) const;
+    void screenCells(std::vector<CloseApproachEvent>& hits);
+    void testPair(const SweptBody& a, const SweptBody& b, std::vector<CloseApproachEvent>& hits) const;
+
+    CloseApproachSettings settings_;
+    float cellSize_;
+
+    // Previous sample
+    std::vector<float> previousX_, previousY_;
+    double previousTime_;
+    double currentTime_;
+    const BodyPositions* current_;
+
+    // Swept circle per body: the midpoint of its step and half the distance moved
+    std::vector<float> midX_, midY_, radius_;
+
+    // Grid: bodies sorted by cell key, patched each step for the few that changed cell
+    std::vector<uint64_t> keys_, newKeys_;
+    std::vector<uint32_t> order_, staying_, moving_;
+    std::vector<std::pair<uint64_t, uint32_t>> sortItems_, sortScratch_;
+    std::vector<Cell> cells_;
+    std::vector<SweptBody> swept_;
+    uint32_t levelMask_;            // Bit per grid level that holds at least one body
+
+    // Encounters below the threshold at the last step, keyed by first << 32 | second
+    std::unordered_map<uint64_t, Encounter> active_;
+    uint64_t updates_;
+    CloseApproachStats stats_;
+};
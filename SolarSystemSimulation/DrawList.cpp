@@ -0,0 +1,228 @@
+// DrawList.cpp : Culling, level of detail and batch assembly for the viewer.
+//
+#include "DrawList.h"
+#include "Profiler.h"
+#include "SolarSystemSimulation.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const uint32_t NOT_BUILT = UINT32_MAX;
+
+// Segments the immediate-mode viewer used for every circle and orbit
+const int IMMEDIATE_SEGMENTS = 100;
+
+// Color of orbit polylines
+const float ORBIT_GRAY = 0.5f;
+
+// Function to test whether a circle overlaps the view rectangle. Uses & rather
+// than && so scattered bodies do not cost a mispredicted branch per comparison.
+inline bool circleVisible(const ViewBounds& view, float x, float y, float radius) {
+    return (x + radius >= view.minX) & (x - radius <= view.maxX) & (y + radius >= view.minY) & (y - radius <= view.maxY);
+}
+
+// Function to pick the segment count for a circle of the given on-screen
+// radius so each edge is about edgePixels long
+inline int segmentsFor(float radiusPixels, float edgePixels, int minSegments, int maxSegments) {
+    float segments = TWO_PI * radiusPixels / edgePixels;
+    return std::clamp(static_cast<int>(segments), minSegments, maxSegments);
+}
+
+} // namespace
+
+ViewBounds makeViewBounds(int widthPixels, int heightPixels, float zoomLevel, float xOffset, float yOffset) {
+    // Screen = zoom * (scene + offset), and the screen spans +-halfHeight vertically
+    float aspectRatio = static_cast<float>(widthPixels) / static_cast<float>(heightPixels);
+    float halfHeight = VIEW_HALF_HEIGHT / zoomLevel;
+    float halfWidth = halfHeight * aspectRatio;
+    ViewBounds view;
+    view.minX = -halfWidth - xOffset;
+    view.maxX = halfWidth - xOffset;
+    view.minY = -halfHeight - yOffset;
+    view.maxY = halfHeight - yOffset;
+    view.pixelsPerUnit = static_cast<float>(heightPixels) / (2.0f * halfHeight);
+    return view;
+}
+
+void DrawListBuilder::setBodies(const BodyCatalog& catalog) {
+    styles_ = catalog.styles;
+    orbits_.clear();
+    orbitVertices_.clear();
+    const OrbitalElements& elements = catalog.elements;
+    for (size_t i = 0; i < catalog.size(); i++) {
+        if (!(styles_[i].flags & STYLE_DRAW_ORBIT)) continue;
+        Orbit orbit;
+        orbit.semiMajorAxis = elements.semiMajorAxis[i];
+        orbit.semiMinorAxis = elements.semiMinorAxis[i];
+        orbit.eccentricity = elements.eccentricity[i];
+        orbit.periapsisCos = elements.periapsisCos[i];
+        orbit.periapsisSin = elements.periapsisSin[i];
+        // The center sits a * e from the Sun, away from periapsis
+        orbit.centerX = -orbit.semiMajorAxis * orbit.eccentricity * orbit.periapsisCos;
+        orbit.centerY = -orbit.semiMajorAxis * orbit.eccentricity * orbit.periapsisSin;
+        std::fill(orbit.first, orbit.first + ORBIT_LEVELS, NOT_BUILT);
+        orbits_.push_back(orbit);
+    }
+}
+
+const std::vector<float>& DrawListBuilder::unitDisc(int segments) {
+    if (unitDiscs_.empty()) unitDiscs_.resize(MAX_DISC_SEGMENTS + 1);
+    std::vector<float>& disc = unitDiscs_[segments];
+    if (disc.empty()) {
+        disc.resize(2 * static_cast<size_t>(segments));
+        for (int k = 0; k < segments; k++) {
+            float angle = TWO_PI * static_cast<float>(k) / static_cast<float>(segments);
+            disc[2 * k] = std::cos(angle);
+            disc[2 * k + 1] = std::sin(angle);
+        }
+    }
+    return disc;
+}
+
+uint32_t DrawListBuilder::orbitVertices(size_t index, int level) {
+    Orbit& orbit = orbits_[index];
+    if (orbit.first[level] != NOT_BUILT) return orbit.first[level];
+
+    // Points are spaced evenly in eccentric anomaly, which crowds them toward
+    // the ends of the ellipse where it curves most
+    int segments = MIN_ORBIT_SEGMENTS << level;
+    uint32_t first = static_cast<uint32_t>(orbitVertices_.size() / 2);
+    for (int k = 0; k < segments; k++) {
+        float eccentricAnomaly = TWO_PI * static_cast<float>(k) / static_cast<float>(segments);
+        float x = orbit.semiMajorAxis * (std::cos(eccentricAnomaly) - orbit.eccentricity);
+        float y = orbit.semiMinorAxis * std::sin(eccentricAnomaly);
+        orbitVertices_.push_back(x * orbit.periapsisCos - y * orbit.periapsisSin);
+        orbitVertices_.push_back(x * orbit.periapsisSin + y * orbit.periapsisCos);
+    }
+    orbit.first[level] = first;
+    return first;
+}
+
+void DrawListBuilder::addDisc(float x, float y, float radius, int segments, float r, float g, float b) {
+    const std::vector<float>& disc = unitDisc(segments);
+    uint32_t center = static_cast<uint32_t>(discVertices_.size() / 2);
+
+    // A center vertex plus the rim, stamped from the shared unit disc
+    discVertices_.push_back(x);
+    discVertices_.push_back(y);
+    for (int k = 0; k < segments; k++) {
+        discVertices_.push_back(x + disc[2 * k] * radius);
+        discVertices_.push_back(y + disc[2 * k + 1] * radius);
+    }
+    for (int k = 0; k <= segments; k++) {
+        discColors_.push_back(r);
+        discColors_.push_back(g);
+        discColors_.push_back(b);
+    }
+    for (int k = 0; k < segments; k++) {
+        discIndices_.push_back(center);
+        discIndices_.push_back(center + 1 + static_cast<uint32_t>(k));
+        discIndices_.push_back(center + 1 + static_cast<uint32_t>((k + 1) % segments));
+    }
+}
+
+void DrawListBuilder::build(const SimulationSnapshot& snapshot, const ViewBounds& view) {
+    ScopedTimer timer("draw list");
+    stats_ = DrawStats();
+    batches_.clear();
+    orbitIndices_.clear();
+    discVertices_.clear();
+    discColors_.clear();
+    discIndices_.clear();
+    pointVertices_.clear();
+    pointColors_.clear();
+
+    // Orbits: cull whole ellipses by their bounding circle, pick a cached level,
+    // then keep only the segments that cross the view
+    size_t orbitVertexCount = 0;
+    for (size_t o = 0; o < orbits_.size(); o++) {
+        const Orbit& orbit = orbits_[o];
+        if (!circleVisible(view, orbit.centerX, orbit.centerY, orbit.semiMajorAxis)) {
+            stats_.culledOrbits++;
+            continue;
+        }
+        int wanted = segmentsFor(orbit.semiMajorAxis * view.pixelsPerUnit, ORBIT_EDGE_PIXELS, MIN_ORBIT_SEGMENTS, MIN_ORBIT_SEGMENTS << (ORBIT_LEVELS - 1));
+        int level = 0;
+        while ((MIN_ORBIT_SEGMENTS << level) < wanted && level < ORBIT_LEVELS - 1) level++;
+        uint32_t segments = static_cast<uint32_t>(MIN_ORBIT_SEGMENTS << level);
+        uint32_t first = orbitVertices(o, level);
+        const float* vertices = &orbitVertices_[2 * static_cast<size_t>(first)];
+        for (uint32_t k = 0; k < segments; k++) {
+            uint32_t next = (k + 1) % segments;
+            float x0 = vertices[2 * k], y0 = vertices[2 * k + 1];
+            float x1 = vertices[2 * next], y1 = vertices[2 * next + 1];
+            if (std::max(x0, x1) < view.minX || std::min(x0, x1) > view.maxX ||
+                std::max(y0, y1) < view.minY || std::min(y0, y1) > view.maxY) continue;
+            orbitIndices_.push_back(first + k);
+            orbitIndices_.push_back(first + next);
+            orbitVertexCount++;
+        }
+    }
+
+    // Bodies: the Sun and anything large on screen become discs, the rest points
+    if (circleVisible(view, 0.0f, 0.0f, SUN_RADIUS)) {
+        addDisc(0.0f, 0.0f, SUN_RADIUS, segmentsFor(SUN_RADIUS * view.pixelsPerUnit, DISC_EDGE_PIXELS, MIN_DISC_SEGMENTS, MAX_DISC_SEGMENTS),
+            1.0f, 1.0f, 0.0f);
+    }
+    // Points are written through a pre-sized array; with a large catalog almost
+    // every body lands here
+    size_t count = std::min(snapshot.x.size(), styles_.size());
+    pointVertices_.resize(2 * count);
+    pointColors_.resize(3 * count);
+    float* points = pointVertices_.data();
+    float* colors = pointColors_.data();
+    size_t pointCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        const BodyStyle& style = styles_[i];
+        float x = snapshot.x[i], y = snapshot.y[i];
+        if (!circleVisible(view, x, y, style.size)) {
+            stats_.culledBodies++;
+            continue;
+        }
+        float radiusPixels = style.size * view.pixelsPerUnit;
+        if (radiusPixels < POINT_RADIUS_PIXELS) {
+            points[2 * pointCount] = x;
+            points[2 * pointCount + 1] = y;
+            colors[3 * pointCount] = style.r;
+            colors[3 * pointCount + 1] = style.g;
+            colors[3 * pointCount + 2] = style.b;
+            pointCount++;
+        } else {
+            addDisc(x, y, style.size, segmentsFor(radiusPixels, DISC_EDGE_PIXELS, MIN_DISC_SEGMENTS, MAX_DISC_SEGMENTS),
+                style.r, style.g, style.b);
+        }
+    }
+    pointVertices_.resize(2 * pointCount);
+    pointColors_.resize(3 * pointCount);
+
+    // One draw call per primitive type, back to front: orbits, points, discs
+    if (!orbitIndices_.empty()) {
+        batches_.push_back({ DrawPrimitive::Lines, orbitVertices_.data(), nullptr, orbitIndices_.data(),
+            orbitIndices_.size(), orbitVertexCount, ORBIT_GRAY, ORBIT_GRAY, ORBIT_GRAY, 1.0f });
+    }
+    if (!pointVertices_.empty()) {
+        batches_.push_back({ DrawPrimitive::Points, pointVertices_.data(), pointColors_.data(), nullptr,
+            pointVertices_.size() / 2, pointVertices_.size() / 2, 1.0f, 1.0f, 1.0f, 2.0f * POINT_RADIUS_PIXELS });
+    }
+    if (!discIndices_.empty()) {
+        batches_.push_back({ DrawPrimitive::Triangles, discVertices_.data(), discColors_.data(), discIndices_.data(),
+            discIndices_.size(), discVertices_.size() / 2, 1.0f, 1.0f, 1.0f, 1.0f });
+    }
+
+    stats_.drawCalls = batches_.size();
+    for (const DrawBatch& batch : batches_) stats_.vertices += batch.vertexCount;
+}
+
+DrawStats immediateModeStats(const BodyCatalog& catalog) {
+    DrawStats stats;
+    size_t orbits = 0;
+    for (const BodyStyle& style : catalog.styles) {
+        if (style.flags & STYLE_DRAW_ORBIT) orbits++;
+    }
+    // Sun and bodies: a center plus 101 rim vertices each; orbits: 101 vertices each
+    size_t discs = catalog.size() + 1;
+    stats.drawCalls = discs + orbits;
+    stats.vertices = discs * (IMMEDIATE_SEGMENTS + 2) + orbits * (IMMEDIATE_SEGMENTS + 1);
+    return stats;
+}
@@ -0,0 +1,118 @@
+// DrawList.h : GPU-independent scene batching for the viewer. Orbits are cached
+// polylines, bodies share precomputed disc meshes or collapse to points, and
+// anything outside the view is culled before a single vertex is emitted. The
+// viewer submits the batches to OpenGL; tools can count them without a GPU.
+
+#pragma once
+
+#include "BodyCatalog.h"
+#include "SimulationEngine.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Default window and the half-height of the orthographic view at zoom 1, in scene units
+const int VIEW_WIDTH_PIXELS = 3840;
+const int VIEW_HEIGHT_PIXELS = 2160;
+const float VIEW_HALF_HEIGHT = 10.0f;
+
+// The Sun, drawn at the origin
+const float SUN_RADIUS = 0.1f;
+
+// Level-of-detail limits
+const float POINT_RADIUS_PIXELS = 1.5f;    // Bodies smaller than this on screen become points
+const float DISC_EDGE_PIXELS = 3.0f;       // Target edge length of a disc outline on screen
+const float ORBIT_EDGE_PIXELS = 6.0f;      // Target edge length of an orbit polyline on screen
+const int MIN_DISC_SEGMENTS = 8;
+const int MAX_DISC_SEGMENTS = 64;
+const int MIN_ORBIT_SEGMENTS = 32;
+const int ORBIT_LEVELS = 5;                // Orbits use 32, 64, ... 512 segments
+
+// Structure to hold the visible part of the scene after zoom and pan
+struct ViewBounds {
+    float minX, minY, maxX, maxY;   // Scene units
+    float pixelsPerUnit;
+};
+
+// Function to compute the view for the viewer's transform: glOrtho over
+// +-VIEW_HALF_HEIGHT (times the aspect ratio), then scale by zoomLevel and
+// translate by (xOffset, yOffset)
+ViewBounds makeViewBounds(int widthPixels, int heightPixels, float zoomLevel, float xOffset, float yOffset);
+
+// Primitive types, matching the GL modes the viewer maps them to
+enum class DrawPrimitive {
+    Points,
+    Lines,
+    Triangles
+};
+
+// Structure to hold one draw call. Vertices are interleaved x, y pairs; colors
+// are r, g, b per vertex, or null to use the batch color for every vertex.
+// When indices is set, count is the number of indices rather than vertices.
+struct DrawBatch {
+    DrawPrimitive primitive;
+    const float* vertices;
+    const float* colors;
+    const uint32_t* indices;
+    size_t count;
+    size_t vertexCount;     // Distinct vertices referenced by the batch
+    float r, g, b;
+    float pointSize;        // Pixels, for Points batches
+};
+
+// Structure to hold what a frame costs to submit
+struct DrawStats {
+    size_t drawCalls = 0;
+    size_t vertices = 0;        // Vertices sent to the GPU
+    size_t culledBodies = 0;
+    size_t culledOrbits = 0;
+};
+
+class DrawListBuilder {
+public:
+    // Function to take the styles and orbit shapes of a catalog; cached orbit
+    // polylines are discarded and rebuilt on demand
+    void setBodies(const BodyCatalog& catalog);
+
+    // Function to rebuild the batches for one frame. The batches point into the
+    // builder and stay valid until the next build or setBodies call.
+    void build(const SimulationSnapshot& snapshot, const ViewBounds& view);
+
+    const std::vector<DrawBatch>& batches() const { return batches_; }
+    const DrawStats& stats() const { return stats_; }
+
+    // Number of vertices currently held in the orbit cache
+    size_t cachedOrbitVertices() const { return orbitVertices_.size() / 2; }
+
+private:
+    // Structure to hold the shape of an orbit drawn with STYLE_DRAW_ORBIT
+    struct Orbit {
+        float semiMajorAxis, semiMinorAxis, eccentricity;
+        float periapsisCos, periapsisSin;
+        float centerX, centerY;         // Ellipse center; the Sun sits at a focus
+        uint32_t first[ORBIT_LEVELS];   // First cached vertex per level, or UINT32_MAX if not built yet
+    };
+
+    const std::vector<float>& unitDisc(int segments);
+    uint32_t orbitVertices(size_t orbit, int level);
+    void addDisc(float x, float y, float radius, int segments, float r, float g, float b);
+
+    std::vector<BodyStyle> styles_;
+    std::vector<Orbit> orbits_;
+
+    // Caches that persist across frames
+    std::vector<float> orbitVertices_;
+    std::vector<std::vector<float>> unitDiscs_;     // cos, sin pairs indexed by segment count
+
+    // Per-frame geometry
+    std::vector<uint32_t> orbitIndices_;
+    std::vector<float> discVertices_, discColors_;
+    std::vector<uint32_t> discIndices_;
+    std::vector<float> pointVertices_, pointColors_;
+    std::vector<DrawBatch> batches_;
+    DrawStats stats_;
+};
+
+// Function to count what the original immediate-mode viewer submitted for the
+// same bodies: one glBegin / glEnd per body and orbit, with 100 segments each
+DrawStats immediateModeStats(const BodyCatalog& catalog);
@@ -0,0 +1,343 @@
+// Ephemeris.cpp : Chebyshev fitting, Clenshaw evaluation and the segment cache.
+//
+#include "Ephemeris.h"
+#include "KeplerPropagator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double EPHEMERIS_PI = 3.14159265358979323846;
+const double EPHEMERIS_TWO_PI = 2.0 * EPHEMERIS_PI;
+
+// Largest segment index a double still counts exactly; lookups past it are refused
+const double MAX_SEGMENT_INDEX = 9007199254740992.0;
+
+// A derived tolerance is this many times the source's resolution, and this
+// absolute value when the source is exact
+const double RESOLUTION_TOLERANCE = 2.0;
+const double EXACT_SOURCE_TOLERANCE = 1e-8;
+
+// Function to evaluate a Chebyshev series at tau in [-1, 1] with Clenshaw's recurrence
+double clenshaw(const double* coefficients, int count, double tau) {
+    double b1 = 0.0, b2 = 0.0;
+    for (int k = count - 1; k >= 1; k--) {
+        double b0 = 2.0 * tau * b1 - b2 + coefficients[k];
+        b2 = b1;
+        b1 = b0;
+    }
+    return tau * b1 - b2 + coefficients[0];
+}
+
+// Function to evaluate the derivative of a Chebyshev series with respect to tau
+double clenshawDerivative(const double* coefficients, int count, double tau) {
+    // T'_0 = 0, T'_1 = 1, T'_{k+1} = 2 T_k + 2 tau T'_k - T'_{k-1}
+    double tPrev = 1.0, t = tau;
+    double dPrev = 0.0, d = 1.0;
+    double sum = count > 1 ? coefficients[1] : 0.0;
+    for (int k = 2; k < count; k++) {
+        double tNext = 2.0 * tau * t - tPrev;
+        double dNext = 2.0 * t + 2.0 * tau * d - dPrev;
+        sum += coefficients[k] * dNext;
+        tPrev = t; t = tNext;
+        dPrev = d; d = dNext;
+    }
+    return sum;
+}
+
+} // namespace
+
+KeplerEphemerisSource::KeplerEphemerisSource(const OrbitalElements& elements, double epoch)
+    : elements_(elements), epoch_(epoch) {}
+
+double KeplerEphemerisSource::startTime() const {
+    return std::numeric_limits<double>::lowest();
+}
+
+double KeplerEphemerisSource::endTime() const {
+    return std::numeric_limits<double>::max();
+}
+
+double KeplerEphemerisSource::orbitalPeriod(size_t body) const {
+    return EPHEMERIS_TWO_PI / elements_.meanMotion[body];
+}
+
+double KeplerEphemerisSource::resolution(size_t body) const {
+    // Elements are single precision and positions are shown as floats, so a fit
+    // is as good as it gets once it is within a float step of the apoapsis
+    double apoapsis = elements_.semiMajorAxis[body] * (1.0 + elements_.eccentricity[body]);
+    return apoapsis * std::numeric_limits<float>::epsilon();
+}
+
+void KeplerEphemerisSource::sample(size_t body, double time, double& x, double& y) const {
+    keplerPositionAt(elements_, body, time - epoch_, x, y);
+}
+
+RecordedEphemerisSource::RecordedEphemerisSource(size_t bodyCount, double gridSpacing)
+    : bodyCount_(bodyCount), gridSpacing_(gridSpacing), rounding_(bodyCount, 0.0) {}
+
+void RecordedEphemerisSource::record(double time, const NBodySystem& system) {
+    size_t offset = states_.size();
+    states_.resize(offset + 4 * bodyCount_);
+    for (size_t i = 0; i < bodyCount_; i++) {
+        double* state = &states_[offset + 4 * i];
+        state[0] = system.x[i];
+        state[1] = system.y[i];
+        state[2] = system.vx[i];
+        state[3] = system.vy[i];
+        double extent = std::max(std::fabs(state[0]), std::fabs(state[1]));
+        rounding_[i] = std::max(rounding_[i], extent * std::numeric_limits<double>::epsilon());
+    }
+    times_.push_back(time);
+}
+
+void RecordedEphemerisSource::recordPositions(double time, const float* x, const float* y) {
+    size_t offset = states_.size();
+    states_.resize(offset + 4 * bodyCount_);
+    times_.push_back(time);
+    size_t count = times_.size();
+    double* last = &states_[offset];
+    for (size_t i = 0; i < bodyCount_; i++) {
+        last[4 * i] = x[i];
+        last[4 * i + 1] = y[i];
+        double extent = std::max(std::fabs(last[4 * i]), std::fabs(last[4 * i + 1]));
+        rounding_[i] = std::max(rounding_[i], extent * std::numeric_limits<float>::epsilon());
+    }
+    if (count < 2) return;
+
+    // The new sample gets a backward difference until a later one arrives; the one
+    // before it now has both neighbours and takes the three-point estimate, which
+    // stays second order on uneven spacing
+    double* middle = last - 4 * bodyCount_;
+    double h1 = times_[count - 1] - times_[count - 2];
+    for (size_t i = 0; i < bodyCount_; i++) {
+        double forwardX = (last[4 * i] - middle[4 * i]) / h1;
+        double forwardY = (last[4 * i + 1] - middle[4 * i + 1]) / h1;
+        last[4 * i + 2] = forwardX;
+        last[4 * i + 3] = forwardY;
+        if (count == 2) {
+            middle[4 * i + 2] = forwardX;
+            middle[4 * i + 3] = forwardY;
+        } else {
+            const double* first = middle - 4 * bodyCount_;
+            double h0 = times_[count - 2] - times_[count - 3];
+            double backwardX = (middle[4 * i] - first[4 * i]) / h0;
+            double backwardY = (middle[4 * i + 1] - first[4 * i + 1]) / h0;
+            middle[4 * i + 2] = (h0 * forwardX + h1 * backwardX) / (h0 + h1);
+            middle[4 * i + 3] = (h0 * forwardY + h1 * backwardY) / (h0 + h1);
+        }
+    }
+}
+
+double RecordedEphemerisSource::resolution(size_t body) const {
+    return std::max(gridSpacing_, rounding_[body]);
+}
+
+double RecordedEphemerisSource::startTime() const {
+    return times_.empty() ? 0.0 : times_.front();
+}
+
+double RecordedEphemerisSource::endTime() const {
+    return times_.empty() ? 0.0 : times_.back();
+}
+
+double RecordedEphemerisSource::orbitalPeriod(size_t body) const {
+    if (times_.empty()) return 0.0;
+
+    // Osculating period around the Sun from the first recorded state (vis-viva)
+    const double* state = &states_[body * 4];
+    double r = std::sqrt(state[0] * state[0] + state[1] * state[1]);
+    double v2 = state[2] * state[2] + state[3] * state[3];
+    double inverseA = 2.0 / r - v2 / SUN_MU;
+    if (inverseA <= 0.0) return 0.0;
+    return EPHEMERIS_TWO_PI / std::sqrt(SUN_MU * inverseA * inverseA * inverseA);
+}
+
+void RecordedEphemerisSource::sample(size_t body, double time, double& x, double& y) const {
+    if (times_.empty()) {
+        x = y = 0.0;
+        return;
+    }
+    if (times_.size() == 1) {
+        x = states_[body * 4];
+        y = states_[body * 4 + 1];
+        return;
+    }
+    time = std::clamp(time, times_.front(), times_.back());
+    size_t index = static_cast<size_t>(std::upper_bound(times_.begin(), times_.end(), time) - times_.begin());
+    index = std::min(index, times_.size() - 1) - 1;
+    const double* a = &states_[(index * bodyCount_ + body) * 4];
+    const double* b = &states_[((index + 1) * bodyCount_ + body) * 4];
+
+    // Cubic Hermite basis on the sample interval
+    double interval = times_[index + 1] - times_[index];
+    double s = (time - times_[index]) / interval;
+    double s2 = s * s, s3 = s2 * s;
+    double h00 = 2.0 * s3 - 3.0 * s2 + 1.0;
+    double h10 = s3 - 2.0 * s2 + s;
+    double h01 = -2.0 * s3 + 3.0 * s2;
+    double h11 = s3 - s2;
+    x = h00 * a[0] + h10 * interval * a[2] + h01 * b[0] + h11 * interval * b[2];
+    y = h00 * a[1] + h10 * interval * a[3] + h01 * b[1] + h11 * interval * b[3];
+}
+
+ChebyshevEphemeris::ChebyshevEphemeris(const EphemerisSource& source, const EphemerisSettings& settings)
+    : source_(source), settings_(settings) {
+    settings_.degree = std::clamp(settings_.degree, 1, MAX_EPHEMERIS_DEGREE);
+    settings_.maxDepth = std::clamp(settings_.maxDepth, 0, MAX_EPHEMERIS_DEPTH);
+    size_t n = static_cast<size_t>(settings_.degree) + 1;
+    nodeCosines_.resize(n * n);
+    for (size_t k = 0; k < n; k++) {
+        for (size_t j = 0; j < n; j++) {
+            nodeCosines_[k * n + j] = std::cos(EPHEMERIS_PI * static_cast<double>(k) * (static_cast<double>(j) + 0.5) / static_cast<double>(n));
+        }
+    }
+    // The fit is exact at the nodes, so it is checked where it strays furthest from them
+    checkPoints_.resize(n + 1);
+    for (size_t j = 0; j <= n; j++) checkPoints_[j] = std::cos(EPHEMERIS_PI * static_cast<double>(j) / static_cast<double>(n));
+}
+
+size_t ChebyshevEphemeris::SegmentKeyHash::operator()(const SegmentKey& key) const {
+    // splitmix64 finalizer over the body and piece mixed into the index
+    uint64_t h = static_cast<uint64_t>(key.index) ^ (static_cast<uint64_t>(key.body) * 0x9E3779B97F4A7C15ull) ^
+        ((static_cast<uint64_t>(key.depth) << 32 | key.piece) * 0xC2B2AE3D27D4EB4Full);
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<size_t>(h ^ (h >> 31));
+}
+
+double ChebyshevEphemeris::segmentLengthFor(size_t body) const {
+    double period = source_.orbitalPeriod(body);
+    double length = period / settings_.segmentsPerOrbit;
+    return std::isfinite(length) && length > 0.0 ? length : settings_.segmentLength;
+}
+
+double ChebyshevEphemeris::toleranceFor(size_t body) const {
+    if (settings_.tolerance > 0.0) return settings_.tolerance;
+    double resolution = source_.resolution(body);
+    return resolution > 0.0 ? RESOLUTION_TOLERANCE * resolution : EXACT_SOURCE_TOLERANCE;
+}
+
+void ChebyshevEphemeris::fitSegment(const SegmentKey& key, double length, Segment& segment) const {
+    size_t n = static_cast<size_t>(settings_.degree) + 1;
+    segment.count = static_cast<int>(n);
+
+    // Pieces are clipped to the source's range so recorded runs are never extrapolated
+    double pieceLength = std::ldexp(length, -static_cast<int>(key.depth));
+    double nominal = static_cast<double>(key.index) * length + static_cast<double>(key.piece) * pieceLength;
+    double start = std::max(nominal, source_.startTime());
+    double end = std::min(nominal + pieceLength, source_.endTime());
+    segment.start = start;
+    segment.length = std::max(end - start, std::numeric_limits<double>::min());
+    double half = 0.5 * segment.length;
+    double middle = segment.start + half;
+
+    // Sample at the Chebyshev nodes, then project onto T_0 .. T_degree
+    double sampleX[MAX_EPHEMERIS_DEGREE + 1], sampleY[MAX_EPHEMERIS_DEGREE + 1];
+    for (size_t j = 0; j < n; j++) {
+        double tau = nodeCosines_[n + j];  // Row k = 1 holds cos(PI * (j + 0.5) / n)
+        source_.sample(key.body, middle + half * tau, sampleX[j], sampleY[j]);
+    }
+    for (size_t k = 0; k < n; k++) {
+        double sumX = 0.0, sumY = 0.0;
+        for (size_t j = 0; j < n; j++) {
+            sumX += sampleX[j] * nodeCosines_[k * n + j];
+            sumY += sampleY[j] * nodeCosines_[k * n + j];
+        }
+        double scale = (k == 0 ? 1.0 : 2.0) / static_cast<double>(n);
+        segment.coeffX[k] = sumX * scale;
+        segment.coeffY[k] = sumY * scale;
+    }
+
+    segment.error = 0.0;
+    for (double tau : checkPoints_) {
+        double x, y;
+        source_.sample(key.body, middle + half * tau, x, y);
+        double dx = clenshaw(segment.coeffX, segment.count, tau) - x;
+        double dy = clenshaw(segment.coeffY, segment.count, tau) - y;
+        segment.error = std::max(segment.error, std::sqrt(dx * dx + dy * dy));
+    }
+    segment.split = segment.error > toleranceFor(key.body) && key.depth < static_cast<uint32_t>(settings_.maxDepth);
+}
+
+void ChebyshevEphemeris::findSegment(const SegmentKey& key, double length, Segment& segment) {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        auto found = cache_.find(key);
+        if (found != cache_.end()) {
+            recency_.splice(recency_.begin(), recency_, found->second.recency);
+            segment = found->second.segment;
+            hits_++;
+            return;
+        }
+        misses_++;
+    }
+
+    // Fit outside the lock so other threads keep hitting the cache meanwhile
+    fitSegment(key, length, segment);
+
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (!segment.split) maxFitError_ = std::max(maxFitError_, segment.error);
+    if (cache_.find(key) == cache_.end()) {
+        recency_.push_front(key);
+        cache_[key] = CacheEntry{ segment, recency_.begin() };
+        while (cache_.size() > settings_.cacheCapacity) {
+            cache_.erase(recency_.back());
+            recency_.pop_back();
+        }
+    }
+}
+
+bool ChebyshevEphemeris::lookup(size_t body, double time, Segment& segment) {
+    if (body >= source_.bodyCount() || !std::isfinite(time) || time < source_.startTime() || time > source_.endTime()) return false;
+
+    double length = segmentLengthFor(body);
+    double position = std::floor(time / length);
+    if (!(std::fabs(position) < MAX_SEGMENT_INDEX)) return false;
+    int64_t index = static_cast<int64_t>(position);
+    if (static_cast<double>(index) * length >= source_.endTime()) index--;
+
+    // Halve the segment until the piece holding time fits within the tolerance
+    SegmentKey key = { body, index, 0, 0 };
+    findSegment(key, length, segment);
+    while (segment.split) {
+        double nominalMiddle = static_cast<double>(index) * length +
+            (static_cast<double>(key.piece) + 0.5) * std::ldexp(length, -static_cast<int>(key.depth));
+        key.depth++;
+        key.piece = 2 * key.piece + (time >= nominalMiddle ? 1 : 0);
+        findSegment(key, length, segment);
+    }
+    return true;
+}
+
+bool ChebyshevEphemeris::position(size_t body, double time, double& x, double& y) {
+    Segment segment;
+    if (!lookup(body, time, segment)) return false;
+    double tau = std::clamp(2.0 * (time - segment.start) / segment.length - 1.0, -1.0, 1.0);
+    x = clenshaw(segment.coeffX, segment.count, tau);
+    y = clenshaw(segment.coeffY, segment.count, tau);
+    return true;
+}
+
+bool ChebyshevEphemeris::state(size_t body, double time, double& x, double& y, double& vx, double& vy) {
+    Segment segment;
+    if (!lookup(body, time, segment)) return false;
+    double tau = std::clamp(2.0 * (time - segment.start) / segment.length - 1.0, -1.0, 1.0);
+    double dTau = 2.0 / segment.length;
+    x = clenshaw(segment.coeffX, segment.count, tau);
+    y = clenshaw(segment.coeffY, segment.count, tau);
+    vx = clenshawDerivative(segment.coeffX, segment.count, tau) * dTau;
+    vy = clenshawDerivative(segment.coeffY, segment.count, tau) * dTau;
+    return true;
+}
+
+size_t ChebyshevEphemeris::cachedSegments() const {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    return cache_.size();
+}
+
+double ChebyshevEphemeris::maxFitError() const {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    return maxFitError_;
+}
@@ -0,0 +1,180 @@
+// Ephemeris.h : Piecewise Chebyshev ephemeris with a bounded LRU cache of
+// segment coefficients, for position / velocity lookup at arbitrary epochs.
+
+#pragma once
+
+#include "NBody.h"
+#include "OrbitalElements.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Interface the ephemeris samples when it builds a segment's coefficients
+class EphemerisSource {
+public:
+    virtual ~EphemerisSource() = default;
+
+    virtual size_t bodyCount() const = 0;
+
+    // Function to return the time range the source can be sampled over
+    virtual double startTime() const = 0;
+    virtual double endTime() const = 0;
+
+    // Function to return the orbital period of a body, or 0 when it is not known
+    virtual double orbitalPeriod(size_t /*body*/) const { return 0.0; }
+
+    // Function to return how finely a body's positions are known, in scene units,
+    // or 0 when they are exact. Fitting closer than this only chases noise.
+    virtual double resolution(size_t /*body*/) const { return 0.0; }
+
+    // Function to return the position of a body at the given simulated time
+    virtual void sample(size_t body, double time, double& x, double& y) const = 0;
+};
+
+// Analytic two-body source: positions come straight from the orbital elements
+class KeplerEphemerisSource : public EphemerisSource {
+public:
+    // epoch is the simulated time at which elements' mean anomalies are valid
+    KeplerEphemerisSource(const OrbitalElements& elements, double epoch);
+
+    size_t bodyCount() const override { return elements_.size(); }
+    double startTime() const override;
+    double endTime() const override;
+    double orbitalPeriod(size_t body) const override;
+    double resolution(size_t body) const override;
+    void sample(size_t body, double time, double& x, double& y) const override;
+
+private:
+    OrbitalElements elements_;
+    double epoch_;
+};
+
+// Source replayed from recorded output (e.g. an N-body run or a trajectory
+// file): states are stored at increasing times, not necessarily evenly spaced,
+// and interpolated with cubic Hermite splines
+class RecordedEphemerisSource : public EphemerisSource {
+public:
+    // gridSpacing is the spacing positions were rounded to when stored, such as
+    // a delta-quantized trajectory's quantization, or 0 if they were not
+    explicit RecordedEphemerisSource(size_t bodyCount, double gridSpacing = 0.0);
+
+    // Function to append the full state at time; times must increase
+    void record(double time, const NBodySystem& system);
+
+    // Function to append positions only, e.g. frames read back from a trajectory.
+    // Velocities are then estimated from the neighbouring samples. Do not mix
+    // with record() in the same source.
+    void recordPositions(double time, const float* x, const float* y);
+
+    size_t bodyCount() const override { return bodyCount_; }
+    double startTime() const override;
+    double endTime() const override;
+    double orbitalPeriod(size_t body) const override;
+    double resolution(size_t body) const override;
+    void sample(size_t body, double time, double& x, double& y) const override;
+
+    size_t sampleCount() const { return times_.size(); }
+
+private:
+    size_t bodyCount_;
+    double gridSpacing_;
+    std::vector<double> rounding_;  // Largest rounding step of each body's recorded coordinates
+    std::vector<double> times_;
+    std::vector<double> states_;  // x, y, vx, vy per body, one block per sample
+};
+
+// Highest Chebyshev degree a segment can hold
+const int MAX_EPHEMERIS_DEGREE = 24;
+
+// Deepest halving of a segment; 2^20 pieces per orbit segment
+const int MAX_EPHEMERIS_DEPTH = 20;
+
+// Structure to hold ephemeris tuning parameters
+struct EphemerisSettings {
+    int degree = 12;                    // Chebyshev polynomial degree per segment (<= MAX_EPHEMERIS_DEGREE)
+    double segmentsPerOrbit = 8.0;      // Segments per orbital period when the period is known
+    double segmentLength = 0.25;        // Segment length in years when it is not
+    double tolerance = 0.0;             // Largest fit residual in scene units before a segment is halved;
+                                        // 0 picks one per body from the source's resolution
+    int maxDepth = 16;                  // Halvings allowed below a top-level segment (<= MAX_EPHEMERIS_DEPTH)
+    size_t cacheCapacity = 1 << 16;     // Maximum segments held before the least recent is evicted
+};
+
+class ChebyshevEphemeris {
+public:
+    // The source must outlive the ephemeris
+    explicit ChebyshevEphemeris(const EphemerisSource& source, const EphemerisSettings& settings = EphemerisSettings());
+
+    // Function to look up a body's position; returns false for an unknown body, a
+    // time outside the source's range or not finite, or a time so far out that
+    // segment indices no longer fit in a double. Safe to call from several threads at once.
+    bool position(size_t body, double time, double& x, double& y);
+
+    // Function to look up a body's position and velocity (scene units per year)
+    bool state(size_t body, double time, double& x, double& y, double& vx, double& vy);
+
+    size_t cachedSegments() const;
+
+    // Largest residual of any segment fitted so far, measured against the source
+    // between the fit nodes; above the tolerance only where maxDepth ran out
+    double maxFitError() const;
+    uint64_t hits() const { return hits_.load(); }
+    uint64_t misses() const { return misses_.load(); }
+
+private:
+    // Structure to hold the fitted coefficients of one body over one segment.
+    // Fixed-size so cache hits copy it out without allocating. A segment whose
+    // fit missed the tolerance is split, and lookups descend into its halves.
+    struct Segment {
+        double start, length;
+        int count;
+        bool split;
+        double error;               // Largest residual at the check points
+        double coeffX[MAX_EPHEMERIS_DEGREE + 1];
+        double coeffY[MAX_EPHEMERIS_DEGREE + 1];
+    };
+
+    // Structure to hold what identifies a segment: the body, the full 64-bit
+    // top-level index, and which of the 2^depth pieces of it
+    struct SegmentKey {
+        size_t body;
+        int64_t index;
+        uint32_t depth;
+        uint32_t piece;
+        bool operator==(const SegmentKey& other) const {
+            return body == other.body && index == other.index && depth == other.depth && piece == other.piece;
+        }
+    };
+
+    struct SegmentKeyHash {
+        size_t operator()(const SegmentKey& key) const;
+    };
+
+    // Structure to hold a cached segment and its position in the recency list
+    struct CacheEntry {
+        Segment segment;
+        std::list<SegmentKey>::iterator recency;
+    };
+
+    double segmentLengthFor(size_t body) const;
+    double toleranceFor(size_t body) const;
+    void fitSegment(const SegmentKey& key, double length, Segment& segment) const;
+    void findSegment(const SegmentKey& key, double length, Segment& segment);
+    bool lookup(size_t body, double time, Segment& segment);
+
+    const EphemerisSource& source_;
+    EphemerisSettings settings_;
+    std::vector<double> nodeCosines_;   // cos(PI * k * (j + 0.5) / n) for the fit
+    std::vector<double> checkPoints_;   // cos(PI * j / n): the ends and midway between nodes
+
+    mutable std::mutex cacheMutex_;
+    std::list<SegmentKey> recency_;     // Most recently used first
+    std::unordered_map<SegmentKey, CacheEntry, SegmentKeyHash> cache_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    double maxFitError_ = 0.0;          // Guarded by cacheMutex_
+};
@@ -0,0 +1,312 @@
+// KeplerPropagator.cpp : Batched Kepler solver. One kernel template is
+// instantiated for AVX-512, AVX2 or plain scalar lanes depending on the build.
+//
+#include "KeplerPropagator.h"
+#include "Profiler.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const float KERNEL_PI = 3.14159265358979f;
+const float KERNEL_TWO_PI = 6.28318530718f;
+const float KERNEL_INV_TWO_PI = 0.159154943092f;
+const float KERNEL_TWO_OVER_PI = 0.636619772368f;
+
+// Cody-Waite split of PI / 2 so the quadrant reduction stays exact for |x| well past TWO_PI
+const float REDUCE_1 = 1.5703125f;
+const float REDUCE_2 = 4.837512969970703125e-4f;
+const float REDUCE_3 = 7.54978995489188216e-8f;
+
+// Minimax coefficients for sin and cos on [-PI / 4, PI / 4] (Cephes sinf / cosf)
+const float SIN_C1 = -1.6666654611e-1f;
+const float SIN_C2 = 8.3321608736e-3f;
+const float SIN_C3 = -1.9515295891e-4f;
+const float COS_C1 = 4.166664568298827e-2f;
+const float COS_C2 = -1.388731625493765e-3f;
+const float COS_C3 = 2.443315711809948e-5f;
+
+// Danby's starter E0 = M + k * e * sign(sin M) lands within a few Newton steps of
+// the root for every e < 1, including near-parabolic orbits close to periapsis
+const float STARTER_K = 0.85f;
+
+// Two float ulps at TWO_PI. A residual this small is rounding noise: dividing it
+// by a shallow slope gives steps above KEPLER_TOLERANCE that no longer improve E.
+const float RESIDUAL_FLOOR = 1e-6f;
+
+static_assert(KEPLER_ITERATIONS <= NEWTON_HISTOGRAM_SIZE, "Newton histogram must cover the iteration budget");
+
+// Scalar lane: one body at a time, same operations as the vector lanes
+struct ScalarLane {
+    using Float = float;
+    using Mask = bool;
+    static const size_t WIDTH = 1;
+
+    static Float load(const float* p) { return *p; }
+    static void store(float* p, Float v) { *p = v; }
+    static Float set(float v) { return v; }
+    static Float add(Float a, Float b) { return a + b; }
+    static Float sub(Float a, Float b) { return a - b; }
+    static Float mul(Float a, Float b) { return a * b; }
+    static Float div(Float a, Float b) { return a / b; }
+#if defined(__FMA__)
+    // Fused like the vector lanes, so tail bodies round exactly as a full lane group would
+    static Float mulAdd(Float a, Float b, Float c) { return std::fma(a, b, c); }
+    static Float negMulAdd(Float a, Float b, Float c) { return std::fma(-a, b, c); }
+#else
+    static Float mulAdd(Float a, Float b, Float c) { return a * b + c; }
+    static Float negMulAdd(Float a, Float b, Float c) { return c - a * b; }
+#endif
+    static Float abs(Float a) { return std::fabs(a); }
+    // Truncation-based floor keeps the scalar path inline; |a| stays far below 2^31 here
+    static Float floor(Float a) {
+        Float t = static_cast<Float>(static_cast<int32_t>(a));
+        return t > a ? t - 1.0f : t;
+    }
+    static Float round(Float a) { return floor(a + 0.5f); }
+    static Mask greater(Float a, Float b) { return a > b; }
+    static Mask greaterEqual(Float a, Float b) { return a >= b; }
+    static Mask maskAnd(Mask a, Mask b) { return a && b; }
+    static Mask allTrue() { return true; }
+    static bool none(Mask m) { return !m; }
+    static Float select(Mask m, Float ifTrue, Float ifFalse) { return m ? ifTrue : ifFalse; }
+};
+
+#if defined(__AVX512F__)
+// AVX-512 lane: sixteen bodies per iteration, masks live in k-registers
+struct VectorLane {
+    using Float = __m512;
+    using Mask = __mmask16;
+    static const size_t WIDTH = 16;
+
+    static Float load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, Float v) { _mm512_storeu_ps(p, v); }
+    static Float set(float v) { return _mm512_set1_ps(v); }
+    static Float add(Float a, Float b) { return _mm512_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm512_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm512_div_ps(a, b); }
+    static Float mulAdd(Float a, Float b, Float c) { return _mm512_fmadd_ps(a, b, c); }
+    static Float negMulAdd(Float a, Float b, Float c) { return _mm512_fnmadd_ps(a, b, c); }
+    static Float abs(Float a) { return _mm512_abs_ps(a); }
+    static Float floor(Float a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    static Float round(Float a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static Mask greater(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static Mask greaterEqual(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+    static Mask maskAnd(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+    static Mask allTrue() { return static_cast<Mask>(0xFFFF); }
+    static bool none(Mask m) { return m == 0; }
+    static Float select(Mask m, Float ifTrue, Float ifFalse) { return _mm512_mask_blend_ps(m, ifFalse, ifTrue); }
+};
+#define KEPLER_BACKEND_NAME "AVX-512"
+#elif defined(__AVX2__)
+// AVX2 lane: eight bodies per iteration, masks are all-ones / all-zeros floats
+struct VectorLane {
+    using Float = __m256;
+    using Mask = __m256;
+    static const size_t WIDTH = 8;
+
+    static Float load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+    static Float set(float v) { return _mm256_set1_ps(v); }
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+#if defined(__FMA__)
+    static Float mulAdd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+    static Float negMulAdd(Float a, Float b, Float c) { return _mm256_fnmadd_ps(a, b, c); }
+#else
+    static Float mulAdd(Float a, Float b, Float c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+    static Float negMulAdd(Float a, Float b, Float c) { return _mm256_sub_ps(c, _mm256_mul_ps(a, b)); }
+#endif
+    static Float abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static Float floor(Float a) { return _mm256_floor_ps(a); }
+    static Float round(Float a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static Mask greater(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static Mask greaterEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static Mask maskAnd(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+    static Mask allTrue() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+    static bool none(Mask m) { return _mm256_movemask_ps(m) == 0; }
+    static Float select(Mask m, Float ifTrue, Float ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, m); }
+};
+#define KEPLER_BACKEND_NAME "AVX2"
+#else
+using VectorLane = ScalarLane;
+#define KEPLER_BACKEND_NAME "scalar"
+#endif
+
+// Function to evaluate sin and cos together with a quadrant-reduced polynomial
+template <typename V>
+inline void sinCos(typename V::Float x, typename V::Float& s, typename V::Float& c) {
+    using F = typename V::Float;
+    F j = V::round(V::mul(x, V::set(KERNEL_TWO_OVER_PI)));
+    F r = V::negMulAdd(j, V::set(REDUCE_1), x);
+    r = V::negMulAdd(j, V::set(REDUCE_2), r);
+    r = V::negMulAdd(j, V::set(REDUCE_3), r);
+    F z = V::mul(r, r);
+
+    F sinPoly = V::mulAdd(z, V::set(SIN_C3), V::set(SIN_C2));
+    sinPoly = V::mulAdd(z, sinPoly, V::set(SIN_C1));
+    sinPoly = V::mulAdd(V::mul(z, r), sinPoly, r);
+
+    F cosPoly = V::mulAdd(z, V::set(COS_C3), V::set(COS_C2));
+    cosPoly = V::mulAdd(z, cosPoly, V::set(COS_C1));
+    cosPoly = V::mulAdd(V::mul(z, z), cosPoly, V::negMulAdd(z, V::set(0.5f), V::set(1.0f)));
+
+    // Quadrant index q = j mod 4, kept in float so every lane type shares the same operations
+    F q = V::negMulAdd(V::floor(V::mul(j, V::set(0.25f))), V::set(4.0f), j);
+    F parity = V::negMulAdd(V::floor(V::mul(q, V::set(0.5f))), V::set(2.0f), q);
+    typename V::Mask odd = V::greater(parity, V::set(0.5f));
+    typename V::Mask sinNegative = V::greater(q, V::set(1.5f));
+    typename V::Mask cosNegative = V::maskAnd(V::greater(q, V::set(0.5f)), V::greater(V::set(2.5f), q));
+
+    F sinBase = V::select(odd, cosPoly, sinPoly);
+    F cosBase = V::select(odd, sinPoly, cosPoly);
+    F zero = V::set(0.0f);
+    s = V::select(sinNegative, V::sub(zero, sinBase), sinBase);
+    c = V::select(cosNegative, V::sub(zero, cosBase), cosBase);
+}
+
+// Function to advance mean anomalies by one step and wrap them into [0, TWO_PI)
+template <typename V>
+inline typename V::Float advanceAnomaly(typename V::Float meanAnomaly, typename V::Float meanMotion, float deltaTime) {
+    using F = typename V::Float;
+    meanAnomaly = V::mulAdd(meanMotion, V::set(deltaTime), meanAnomaly);
+    F revolutions = V::floor(V::mul(meanAnomaly, V::set(KERNEL_INV_TWO_PI)));
+    return V::negMulAdd(revolutions, V::set(KERNEL_TWO_PI), meanAnomaly);
+}
+
+// Function to advance one lane group's mean anomalies by steps fixed steps
+template <typename V>
+inline void advanceLanes(OrbitalElements& elements, size_t i, float deltaTime, uint64_t steps) {
+    using F = typename V::Float;
+    F meanMotion = V::load(&elements.meanMotion[i]);
+    F meanAnomaly = V::load(&elements.meanAnomaly[i]);
+    for (uint64_t k = 0; k < steps; k++) meanAnomaly = advanceAnomaly<V>(meanAnomaly, meanMotion, deltaTime);
+    V::store(&elements.meanAnomaly[i], meanAnomaly);
+}
+
+// Function to solve Kepler's equation and write Cartesian positions for one lane group.
+// When meanAnomalyOut is non-null the advanced mean anomaly is stored back.
+// Returns the number of Newton iterations the slowest lane needed.
+template <typename V>
+inline int keplerLanes(const OrbitalElements& elements, size_t i, float deltaTime,
+    float* meanAnomalyOut, float* xOut, float* yOut) {
+    using F = typename V::Float;
+    F e = V::load(&elements.eccentricity[i]);
+
+    F meanAnomaly = advanceAnomaly<V>(V::load(&elements.meanAnomaly[i]), V::load(&elements.meanMotion[i]), deltaTime);
+    if (meanAnomalyOut) V::store(meanAnomalyOut, meanAnomaly);
+
+    // Newton's method with a fixed iteration budget; lanes freeze once converged
+    F starterStep = V::mul(e, V::set(STARTER_K));
+    F eccentricAnomaly = V::select(V::greater(V::set(KERNEL_PI), meanAnomaly),
+        V::add(meanAnomaly, starterStep), V::sub(meanAnomaly, starterStep));
+    typename V::Mask active = V::allTrue();
+    F s, c;
+    int iterations = 0;
+    while (iterations < KEPLER_ITERATIONS) {
+        sinCos<V>(eccentricAnomaly, s, c);
+        F residual = V::sub(V::negMulAdd(e, s, eccentricAnomaly), meanAnomaly);
+        F slope = V::negMulAdd(e, c, V::set(1.0f));
+        F delta = V::div(residual, slope);
+        eccentricAnomaly = V::select(active, V::sub(eccentricAnomaly, delta), eccentricAnomaly);
+        active = V::maskAnd(active, V::greaterEqual(V::abs(delta), V::set(KEPLER_TOLERANCE)));
+        active = V::maskAnd(active, V::greater(V::abs(residual), V::set(RESIDUAL_FLOOR)));
+        iterations++;
+        if (V::none(active)) break;
+    }
+
+    // Perifocal position straight from the eccentric anomaly, then rotate by the periapsis
+    sinCos<V>(eccentricAnomaly, s, c);
+    F px = V::mul(V::load(&elements.semiMajorAxis[i]), V::sub(c, e));
+    F py = V::mul(V::load(&elements.semiMinorAxis[i]), s);
+    F rc = V::load(&elements.periapsisCos[i]);
+    F rs = V::load(&elements.periapsisSin[i]);
+    V::store(xOut, V::negMulAdd(py, rs, V::mul(px, rc)));
+    V::store(yOut, V::mulAdd(py, rc, V::mul(px, rs)));
+    return iterations;
+}
+
+// Function to run the lane kernels over [begin, end); meanAnomalyOut is null when time is not advanced
+void runKernel(const OrbitalElements& elements, float* meanAnomalyOut, BodyPositions& positions,
+    float deltaTime, size_t begin, size_t end) {
+    // Iteration counts are tallied locally and published once per call
+    uint64_t iterationCounts[NEWTON_HISTOGRAM_SIZE] = {};
+    size_t i = begin;
+    for (; i + VectorLane::WIDTH <= end; i += VectorLane::WIDTH) {
+        iterationCounts[keplerLanes<VectorLane>(elements, i, deltaTime, meanAnomalyOut ? meanAnomalyOut + i : nullptr,
+            &positions.x[i], &positions.y[i]) - 1]++;
+    }
+    // Tail bodies go through the scalar lane, which runs the same math one at a time
+    for (; i < end; i++) {
+        iterationCounts[keplerLanes<ScalarLane>(elements, i, deltaTime, meanAnomalyOut ? meanAnomalyOut + i : nullptr,
+            &positions.x[i], &positions.y[i]) - 1]++;
+    }
+    if (profilingEnabled()) recordNewtonIterations(iterationCounts);
+}
+
+} // namespace
+
+void propagateBatch(OrbitalElements& elements, BodyPositions& positions, float deltaTime, size_t begin, size_t end) {
+    if (positions.size() < elements.size()) positions.resize(elements.size());
+    runKernel(elements, elements.meanAnomaly.data(), positions, deltaTime, begin, end);
+}
+
+void propagateBatch(OrbitalElements& elements, BodyPositions& positions, float deltaTime) {
+    propagateBatch(elements, positions, deltaTime, 0, elements.size());
+}
+
+void advanceMeanAnomalies(OrbitalElements& elements, float deltaTime, uint64_t steps, size_t begin, size_t end) {
+    size_t i = begin;
+    for (; i + VectorLane::WIDTH <= end; i += VectorLane::WIDTH) advanceLanes<VectorLane>(elements, i, deltaTime, steps);
+    for (; i < end; i++) advanceLanes<ScalarLane>(elements, i, deltaTime, steps);
+}
+
+void solvePositions(const OrbitalElements& elements, BodyPositions& positions, size_t begin, size_t end) {
+    if (positions.size() < elements.size()) positions.resize(elements.size());
+    runKernel(elements, nullptr, positions, 0.0f, begin, end);
+}
+
+void keplerPositionAt(const OrbitalElements& elements, size_t i, double elapsed, double& x, double& y) {
+    const double twoPi = 6.283185307179586;
+    double e = elements.eccentricity[i];
+    double meanAnomaly = std::fmod(elements.meanAnomaly[i] + elements.meanMotion[i] * elapsed, twoPi);
+    if (meanAnomaly < 0.0) meanAnomaly += twoPi;
+
+    double eccentricAnomaly = meanAnomaly + (meanAnomaly < 3.141592653589793 ? STARTER_K : -STARTER_K) * e;
+    for (int k = 0; k < 2 * KEPLER_ITERATIONS; k++) {
+        double delta = (eccentricAnomaly - e * std::sin(eccentricAnomaly) - meanAnomaly) / (1.0 - e * std::cos(eccentricAnomaly));
+        eccentricAnomaly -= delta;
+        if (std::fabs(delta) < 1e-14) break;
+    }
+
+    double px = elements.semiMajorAxis[i] * (std::cos(eccentricAnomaly) - e);
+    double py = elements.semiMinorAxis[i] * std::sin(eccentricAnomaly);
+    x = px * elements.periapsisCos[i] - py * elements.periapsisSin[i];
+    y = px * elements.periapsisSin[i] + py * elements.periapsisCos[i];
+}
+
+float solveKeplerReference(float meanAnomaly, float eccentricity) {
+    float eccentricAnomaly = meanAnomaly + (meanAnomaly < KERNEL_PI ? STARTER_K : -STARTER_K) * eccentricity;
+    for (int i = 0; i < KEPLER_ITERATIONS; i++) {
+        float residual = eccentricAnomaly - eccentricity * sinf(eccentricAnomaly) - meanAnomaly;
+        float delta = residual / (1 - eccentricity * cosf(eccentricAnomaly));
+        eccentricAnomaly -= delta;
+        if (fabs(delta) < KEPLER_TOLERANCE || fabs(residual) <= RESIDUAL_FLOOR) break;
+    }
+    return eccentricAnomaly;
+}
+
+const char* keplerBackendName() {
+    return KEPLER_BACKEND_NAME;
+}
+
+size_t keplerLaneWidth() {
+    return VectorLane::WIDTH;
+}
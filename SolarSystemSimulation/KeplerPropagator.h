@@ -0,0 +1,46 @@
+// KeplerPropagator.h : Batched, vectorized two-body propagation over
+// OrbitalElements.
+
+#pragma once
+
+#include "OrbitalElements.h"
+#include <cstddef>
+#include <cstdint>
+
+// Newton iterations are capped at a fixed count so every SIMD lane does the same
+// amount of work; converged lanes are masked off and stop updating
+const int KEPLER_ITERATIONS = 10;
+const float KEPLER_TOLERANCE = 1e-6f;  // Tolerance for eccentric anomaly approximation
+
+// Function to advance mean anomalies by deltaTime (simulated years) for bodies
+// [begin, end) and write their Cartesian positions. Uses AVX-512 or AVX2 when the
+// build enables them and falls back to a scalar loop with identical math otherwise.
+void propagateBatch(OrbitalElements& elements, BodyPositions& positions, float deltaTime, size_t begin, size_t end);
+
+// Convenience overload covering every body
+void propagateBatch(OrbitalElements& elements, BodyPositions& positions, float deltaTime);
+
+// Function to advance the mean anomalies of bodies [begin, end) by steps fixed
+// steps of deltaTime without solving for positions. Each step repeats the exact
+// float operations of propagateBatch, so steps calls to propagateBatch and one
+// call here followed by solvePositions leave bit-identical elements and positions.
+void advanceMeanAnomalies(OrbitalElements& elements, float deltaTime, uint64_t steps, size_t begin, size_t end);
+
+// Function to compute Cartesian positions for bodies [begin, end) from their
+// current mean anomalies without advancing time
+void solvePositions(const OrbitalElements& elements, BodyPositions& positions, size_t begin, size_t end);
+
+// Function to compute the position of body i after elapsed simulated years from
+// its current mean anomaly, in double precision. Used where a single body is
+// sampled at arbitrary times rather than stepped with the batch.
+void keplerPositionAt(const OrbitalElements& elements, size_t i, double elapsed, double& x, double& y);
+
+// Reference scalar solver using libm, kept to validate the batch kernels.
+// Returns the eccentric anomaly for the given mean anomaly and eccentricity.
+float solveKeplerReference(float meanAnomaly, float eccentricity);
+
+// Name of the instruction set the batch kernels were compiled for
+const char* keplerBackendName();
+
+// Number of bodies processed per SIMD lane group
+size_t keplerLaneWidth();
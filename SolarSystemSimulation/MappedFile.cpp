@@ -0,0 +1,91 @@
+// MappedFile.cpp : POSIX mmap / Win32 file mapping wrapper.
+//
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+    if (size_ == 0) return true;
+
+    mapping_ = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping_) {
+        close();
+        return false;
+    }
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+#else
+bool MappedFile::open(const std::string& path) {
+    close();
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0) {
+        ::close(descriptor);
+        return false;
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ > 0) {
+        void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(descriptor);
+            size_ = 0;
+            return false;
+        }
+        // Catalogs are parsed front to back by every worker's chunk at once
+        madvise(mapped, size_, MADV_WILLNEED);
+        data_ = static_cast<const char*>(mapped);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(descriptor);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+#endif
@@ -0,0 +1,29 @@
+// MappedFile.h : Read-only memory mapping of a whole file.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Function to map path read-only; returns false if it cannot be opened or mapped
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
@@ -0,0 +1,190 @@
+// NBody.cpp : Symplectic N-body stepping with direct or Barnes-Hut forces.
+//
+#include "NBody.h"
+#include "KeplerPropagator.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "SolarSystemSimulation.h"
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+const double NBODY_PI = 3.14159265358979323846;
+const double NBODY_TWO_PI = 2.0 * NBODY_PI;
+const size_t BODY_GRAIN = 1024;        // Minimum bodies per thread for per-body loops
+const int DRIFT_ITERATIONS = 20;       // Newton cap for the Kepler drift
+const double DRIFT_TOLERANCE = 1e-13;
+
+// Function to add the Sun's pull at (x, y)
+inline void addSunAcceleration(double x, double y, double& ax, double& ay) {
+    double r2 = x * x + y * y;
+    double scale = SUN_MU / (r2 * std::sqrt(r2));
+    ax -= scale * x;
+    ay -= scale * y;
+}
+
+// Function to apply a leapfrog drift with the Sun's pull split around it, used for unbound orbits
+void leapfrogDrift(double& x, double& y, double& vx, double& vy, double deltaTime) {
+    double ax = 0.0, ay = 0.0;
+    addSunAcceleration(x, y, ax, ay);
+    vx += 0.5 * deltaTime * ax;
+    vy += 0.5 * deltaTime * ay;
+    x += deltaTime * vx;
+    y += deltaTime * vy;
+    ax = ay = 0.0;
+    addSunAcceleration(x, y, ax, ay);
+    vx += 0.5 * deltaTime * ax;
+    vy += 0.5 * deltaTime * ay;
+}
+
+// Function to move a body along its osculating ellipse around the Sun for deltaTime
+// using Gauss's f and g functions in the eccentric anomaly difference
+void keplerDrift(double& x, double& y, double& vx, double& vy, double deltaTime) {
+    double r0 = std::sqrt(x * x + y * y);
+    double v2 = vx * vx + vy * vy;
+    double inverseA = 2.0 / r0 - v2 / SUN_MU;
+    if (inverseA <= 0.0) {
+        leapfrogDrift(x, y, vx, vy, deltaTime);
+        return;
+    }
+    double a = 1.0 / inverseA;
+    double meanMotion = std::sqrt(SUN_MU * inverseA * inverseA * inverseA);
+    double eCosE0 = 1.0 - r0 * inverseA;
+    double eSinE0 = (x * vx + y * vy) / std::sqrt(SUN_MU * a);
+
+    // Whole revolutions leave the state unchanged, so only the remainder is solved
+    double meanAdvance = std::fmod(meanMotion * deltaTime, NBODY_TWO_PI);
+    double dt = meanAdvance / meanMotion;
+
+    double dE = meanAdvance;
+    for (int i = 0; i < DRIFT_ITERATIONS; i++) {
+        double s = std::sin(dE), c = std::cos(dE);
+        double f = dE - eCosE0 * s + eSinE0 * (1.0 - c) - meanAdvance;
+        double df = 1.0 - eCosE0 * c + eSinE0 * s;
+        double delta = f / df;
+        dE -= delta;
+        if (std::fabs(delta) < DRIFT_TOLERANCE) break;
+    }
+
+    double s = std::sin(dE), c = std::cos(dE);
+    double r = a * (1.0 - eCosE0 * c + eSinE0 * s);
+    double f = 1.0 - a / r0 * (1.0 - c);
+    double g = dt - (dE - s) / meanMotion;
+    double fDot = -std::sqrt(SUN_MU * a) * s / (r * r0);
+    double gDot = 1.0 - a / r * (1.0 - c);
+
+    double newX = f * x + g * vx;
+    double newY = f * y + g * vy;
+    double newVx = fDot * x + gDot * vx;
+    double newVy = fDot * y + gDot * vy;
+    x = newX;
+    y = newY;
+    vx = newVx;
+    vy = newVy;
+}
+
+} // namespace
+
+const double SUN_MU = 4.0 * NBODY_PI * NBODY_PI * SCALE * SCALE * SCALE;
+
+void initializeNBodySystem(NBodySystem& system, const OrbitalElements& elements, const std::vector<float>& masses) {
+    system.resize(elements.size());
+    for (size_t i = 0; i < elements.size(); i++) {
+        double a = elements.semiMajorAxis[i];
+        double e = elements.eccentricity[i];
+        double eccentricAnomaly = solveKeplerReference(elements.meanAnomaly[i], elements.eccentricity[i]);
+        double s = std::sin(eccentricAnomaly), c = std::cos(eccentricAnomaly);
+        double b = a * std::sqrt(1.0 - e * e);
+
+        // Perifocal state; the speed follows from the Sun's gravity rather than the tabulated period
+        double px = a * (c - e), py = b * s;
+        double speedScale = std::sqrt(SUN_MU / a) / (1.0 - e * c);
+        double pvx = -speedScale * s, pvy = speedScale * std::sqrt(1.0 - e * e) * c;
+
+        double rc = elements.periapsisCos[i], rs = elements.periapsisSin[i];
+        system.x[i] = px * rc - py * rs;
+        system.y[i] = px * rs + py * rc;
+        system.vx[i] = pvx * rc - pvy * rs;
+        system.vy[i] = pvx * rs + pvy * rc;
+        system.mu[i] = i < masses.size() ? SUN_MU * masses[i] : 0.0;
+    }
+}
+
+NBodyIntegrator::NBodyIntegrator(const NBodySettings& settings)
+    : settings_(settings), accelerationsValid_(false) {}
+
+void NBodyIntegrator::computeAccelerations(const NBodySystem& system, bool includeSun,
+    std::vector<double>& ax, std::vector<double>& ay) {
+    ScopedTimer timer("forces");
+    size_t count = system.size();
+    ax.assign(count, 0.0);
+    ay.assign(count, 0.0);
+
+    if (settings_.method == ForceMethod::BarnesHut) {
+        tree_.build(system.x.data(), system.y.data(), system.mu.data(), count);
+        parallelFor(0, count, BODY_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                tree_.accelerationAt(system.x[i], system.y[i], i, settings_.openingAngle, settings_.softening, ax[i], ay[i]);
+                if (includeSun) addSunAcceleration(system.x[i], system.y[i], ax[i], ay[i]);
+            }
+        });
+        return;
+    }
+
+    // Direct summation over the massive bodies only; test particles never act as sources
+    std::vector<size_t> sources;
+    for (size_t j = 0; j < count; j++) {
+        if (system.mu[j] > 0.0) sources.push_back(j);
+    }
+    const double eps2 = settings_.softening * settings_.softening;
+    parallelFor(0, count, BODY_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double sumX = 0.0, sumY = 0.0;
+            for (size_t j : sources) {
+                if (j == i) continue;
+                double dx = system.x[j] - system.x[i];
+                double dy = system.y[j] - system.y[i];
+                double r2 = dx * dx + dy * dy + eps2;
+                double scale = system.mu[j] / (r2 * std::sqrt(r2));
+                sumX += scale * dx;
+                sumY += scale * dy;
+            }
+            if (includeSun) addSunAcceleration(system.x[i], system.y[i], sumX, sumY);
+            ax[i] = sumX;
+            ay[i] = sumY;
+        }
+    });
+}
+
+void NBodyIntegrator::kick(NBodySystem& system, double deltaTime) const {
+    parallelFor(0, system.size(), BODY_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            system.vx[i] += deltaTime * ax_[i];
+            system.vy[i] += deltaTime * ay_[i];
+        }
+    });
+}
+
+void NBodyIntegrator::step(NBodySystem& system, double deltaTime) {
+    const bool includeSun = settings_.scheme == IntegratorScheme::Leapfrog;
+    if (!accelerationsValid_ || ax_.size() != system.size()) {
+        computeAccelerations(system, includeSun, ax_, ay_);
+    }
+
+    // Kick-drift-kick; the closing accelerations are reused to open the next step
+    kick(system, 0.5 * deltaTime);
+    parallelFor(0, system.size(), BODY_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (includeSun) {
+                system.x[i] += deltaTime * system.vx[i];
+                system.y[i] += deltaTime * system.vy[i];
+            } else {
+                keplerDrift(system.x[i], system.y[i], system.vx[i], system.vy[i], deltaTime);
+            }
+        }
+    });
+    computeAccelerations(system, includeSun, ax_, ay_);
+    kick(system, 0.5 * deltaTime);
+    accelerationsValid_ = true;
+}
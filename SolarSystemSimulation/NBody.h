@@ -0,0 +1,79 @@
+// NBody.h : Optional N-body integration mode. Bodies orbit a Sun fixed at the
+// origin and perturb each other through direct or Barnes-Hut summation.
+
+#pragma once
+
+#include "BarnesHut.h"
+#include "OrbitalElements.h"
+#include <cstddef>
+#include <vector>
+
+// G * M_sun in scene units^3 / year^2 (4 PI^2 AU^3 / yr^2, scaled by SCALE^3)
+extern const double SUN_MU;
+
+// How mutual accelerations between bodies are summed
+enum class ForceMethod {
+    Direct,     // O(N^2) pairwise sum, the correctness reference
+    BarnesHut   // O(N log N) tree walk with an opening angle
+};
+
+// How the equations of motion are split into symplectic sub-steps
+enum class IntegratorScheme {
+    Leapfrog,       // Kick-drift-kick with the Sun's pull inside the kicks
+    WisdomHolman    // Exact Kepler drift around the Sun, kicks carry only mutual forces
+};
+
+// Structure to hold N-body tuning parameters
+struct NBodySettings {
+    ForceMethod method = ForceMethod::BarnesHut;
+    IntegratorScheme scheme = IntegratorScheme::WisdomHolman;
+    double openingAngle = 0.5;  // Barnes-Hut cell size / distance threshold
+    double softening = 1e-4;    // Plummer softening length in scene units
+};
+
+// Structure to hold Cartesian state for every body in structure-of-arrays form
+struct NBodySystem {
+    std::vector<double> x, y;     // Heliocentric position
+    std::vector<double> vx, vy;   // Heliocentric velocity per simulated year
+    std::vector<double> mu;       // G * mass; 0 for massless test particles
+
+    size_t size() const { return x.size(); }
+
+    void resize(size_t count) {
+        x.resize(count);
+        y.resize(count);
+        vx.resize(count);
+        vy.resize(count);
+        mu.resize(count);
+    }
+};
+
+// Function to build Cartesian state from orbital elements. masses holds solar
+// masses for the first bodies; any body past the end of masses is a test particle.
+void initializeNBodySystem(NBodySystem& system, const OrbitalElements& elements, const std::vector<float>& masses);
+
+class NBodyIntegrator {
+public:
+    explicit NBodyIntegrator(const NBodySettings& settings = NBodySettings());
+
+    // Function to advance the system by one fixed step of deltaTime years
+    void step(NBodySystem& system, double deltaTime);
+
+    // Function to compute accelerations on every body from every other massive
+    // body. When includeSun is set the central term is added as well.
+    void computeAccelerations(const NBodySystem& system, bool includeSun, std::vector<double>& ax, std::vector<double>& ay);
+
+    // Function to discard cached accelerations after the system was changed outside step()
+    void invalidate() { accelerationsValid_ = false; }
+
+    const NBodySettings& settings() const { return settings_; }
+    const BarnesHutTree& tree() const { return tree_; }
+
+private:
+    void kick(NBodySystem& system, double deltaTime) const;
+
+    NBodySettings settings_;
+    BarnesHutTree tree_;
+    std::vector<double> ax_, ay_;
+    bool accelerationsValid_;
+};
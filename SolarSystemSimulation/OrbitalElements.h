@@ -0,0 +1,98 @@
+// OrbitalElements.h : Structure-of-arrays storage for the orbital elements of
+// every propagated body.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Number of per-body arrays in OrbitalElements
+const int ELEMENT_ARRAY_COUNT = 7;
+
+// Structure to hold the orbital elements of all bodies, one array per field, so
+// the batch propagator can stream whole SIMD lanes of each element at once
+struct OrbitalElements {
+    std::vector<float> semiMajorAxis;   // Semi-major axis of the orbit
+    std::vector<float> semiMinorAxis;   // a * sqrt(1 - e^2), cached for the Cartesian conversion
+    std::vector<float> eccentricity;    // Eccentricity of the orbit (0 <= e < 1)
+    std::vector<float> meanMotion;      // Radians per simulated year (TWO_PI / orbital period)
+    std::vector<float> meanAnomaly;     // Current mean anomaly in [0, TWO_PI)
+    std::vector<float> periapsisCos;    // Cosine of the longitude of periapsis
+    std::vector<float> periapsisSin;    // Sine of the longitude of periapsis
+
+    size_t size() const { return semiMajorAxis.size(); }
+
+    void reserve(size_t count) {
+        semiMajorAxis.reserve(count);
+        semiMinorAxis.reserve(count);
+        eccentricity.reserve(count);
+        meanMotion.reserve(count);
+        meanAnomaly.reserve(count);
+        periapsisCos.reserve(count);
+        periapsisSin.reserve(count);
+    }
+
+    void resize(size_t count) {
+        semiMajorAxis.resize(count);
+        semiMinorAxis.resize(count);
+        eccentricity.resize(count);
+        meanMotion.resize(count);
+        meanAnomaly.resize(count);
+        periapsisCos.resize(count);
+        periapsisSin.resize(count);
+    }
+
+    // Function to return pointers to every array, in declaration order, for bulk copies
+    void arrays(float* out[ELEMENT_ARRAY_COUNT]) {
+        out[0] = semiMajorAxis.data();
+        out[1] = semiMinorAxis.data();
+        out[2] = eccentricity.data();
+        out[3] = meanMotion.data();
+        out[4] = meanAnomaly.data();
+        out[5] = periapsisCos.data();
+        out[6] = periapsisSin.data();
+    }
+
+    void arrays(const float* out[ELEMENT_ARRAY_COUNT]) const {
+        out[0] = semiMajorAxis.data();
+        out[1] = semiMinorAxis.data();
+        out[2] = eccentricity.data();
+        out[3] = meanMotion.data();
+        out[4] = meanAnomaly.data();
+        out[5] = periapsisCos.data();
+        out[6] = periapsisSin.data();
+    }
+
+    // Function to fill slot i from classical elements
+    void set(size_t i, float a, float e, float orbitalPeriod, float anomaly, float longitudeOfPeriapsis = 0.0f) {
+        semiMajorAxis[i] = a;
+        semiMinorAxis[i] = a * std::sqrt(1.0f - e * e);
+        eccentricity[i] = e;
+        meanMotion[i] = 6.28318530718f / orbitalPeriod;
+        meanAnomaly[i] = anomaly;
+        periapsisCos[i] = std::cos(longitudeOfPeriapsis);
+        periapsisSin[i] = std::sin(longitudeOfPeriapsis);
+    }
+
+    // Function to append a body and return its index
+    size_t add(float a, float e, float orbitalPeriod, float anomaly, float longitudeOfPeriapsis = 0.0f) {
+        size_t i = size();
+        resize(i + 1);
+        set(i, a, e, orbitalPeriod, anomaly, longitudeOfPeriapsis);
+        return i;
+    }
+};
+
+// Structure to hold propagated heliocentric positions, parallel to OrbitalElements
+struct BodyPositions {
+    std::vector<float> x;
+    std::vector<float> y;
+
+    size_t size() const { return x.size(); }
+
+    void resize(size_t count) {
+        x.resize(count);
+        y.resize(count);
+    }
+};
@@ -0,0 +1,345 @@
+// Parallel.cpp : Work-stealing scheduler with per-worker deques, and the
+// parallel loop and task graph helpers on top of it.
+//
+#include "Parallel.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Chunks per worker for adaptive loops, so stealing can even out uneven chunks
+const size_t CHUNKS_PER_WORKER = 4;
+
+// Times an idle worker looks for work before going to sleep
+const int IDLE_SPINS = 64;
+
+using Task = std::function<void()>;
+
+// Structure to hold one worker's deque. The owner pushes and pops at the back;
+// thieves take from the front, which holds the work queued longest ago.
+struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+};
+
+// Structure to hold the first exception thrown by the tasks of one parallel call.
+// Tasks never let an exception escape into the pool: it would end the worker
+// thread, and the call waiting on them would return while they still run.
+struct TaskFailure {
+    std::mutex mutex;
+    std::exception_ptr exception;
+    std::atomic<bool> failed{false};
+
+    // Function to keep the exception being handled unless an earlier one was kept
+    void capture() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!exception) exception = std::current_exception();
+        failed.store(true, std::memory_order_release);
+    }
+
+    void rethrow() {
+        if (exception) std::rethrow_exception(exception);
+    }
+};
+
+// Function to pin the calling thread to one core
+void pinCurrentThread(size_t core) {
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<int>(core % CPU_SETSIZE), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+
+class Scheduler {
+public:
+    explicit Scheduler(const SchedulerSettings& settings);
+    ~Scheduler();
+
+    const SchedulerSettings& settings() const { return settings_; }
+
+    // Function to queue a task on the calling worker's deque
+    void submit(Task task);
+
+    // Function to run tasks, the caller's own first and then stolen ones, until pending reaches zero
+    void waitFor(const std::atomic<size_t>& pending);
+
+private:
+    bool runOne(size_t self);
+    void workerLoop(size_t index);
+
+    SchedulerSettings settings_;
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;  // Index 0 belongs to threads outside the pool
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> sleepers_{0};
+    std::atomic<bool> stopping_{false};
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+};
+
+// Worker index of the current thread in the pool that owns it; 0 outside the pool
+thread_local const Scheduler* currentScheduler = nullptr;
+thread_local size_t currentWorker = 0;
+
+Scheduler::Scheduler(const SchedulerSettings& settings) : settings_(settings) {
+    size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+    if (settings_.workers == 0) settings_.workers = hardware;
+    for (size_t i = 0; i < settings_.workers; i++) queues_.push_back(std::make_unique<WorkerQueue>());
+
+    // The thread that configures the pool works as worker 0 alongside the rest
+    if (settings_.pinThreads) pinCurrentThread(0);
+    for (size_t i = 1; i < settings_.workers; i++) {
+        threads_.emplace_back(&Scheduler::workerLoop, this, i);
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) thread.join();
+}
+
+void Scheduler::submit(Task task) {
+    size_t self = currentScheduler == this ? currentWorker : 0;
+    {
+        std::lock_guard<std::mutex> lock(queues_[self]->mutex);
+        queues_[self]->tasks.push_back(std::move(task));
+    }
+    queued_++;
+
+    // Taking the sleep mutex orders this against a worker that is just going to sleep
+    if (sleepers_.load() > 0) {
+        { std::lock_guard<std::mutex> lock(sleepMutex_); }
+        wake_.notify_one();
+    }
+}
+
+bool Scheduler::runOne(size_t self) {
+    Task task;
+    {
+        WorkerQueue& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    for (size_t k = 1; !task && k < queues_.size(); k++) {
+        WorkerQueue& victim = *queues_[(self + k) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if (!task) return false;
+    queued_--;
+    task();
+    return true;
+}
+
+void Scheduler::waitFor(const std::atomic<size_t>& pending) {
+    size_t self = currentScheduler == this ? currentWorker : 0;
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!runOne(self)) std::this_thread::yield();
+    }
+}
+
+void Scheduler::workerLoop(size_t index) {
+    currentScheduler = this;
+    currentWorker = index;
+    if (settings_.pinThreads) pinCurrentThread(index);
+
+    while (!stopping_.load()) {
+        bool found = false;
+        for (int spin = 0; spin < IDLE_SPINS && !found; spin++) {
+            found = runOne(index);
+            if (!found) std::this_thread::yield();
+        }
+        if (found) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepers_++;
+        wake_.wait(lock, [&] { return queued_.load() > 0 || stopping_.load(); });
+        sleepers_--;
+    }
+}
+
+// The mutex only guards starting and replacing the pool. Once started, the pool
+// is published through activeScheduler, so every loop, graph launch and settings
+// query reads it with one atomic load.
+std::mutex schedulerMutex;
+SchedulerSettings requestedSettings;
+std::unique_ptr<Scheduler> ownedScheduler;
+std::atomic<Scheduler*> activeScheduler{nullptr};
+
+// Function to return the scheduler, starting it on first use
+Scheduler& scheduler() {
+    Scheduler* pool = activeScheduler.load(std::memory_order_acquire);
+    if (pool) return *pool;
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    if (!ownedScheduler) {
+        ownedScheduler = std::make_unique<Scheduler>(requestedSettings);
+        activeScheduler.store(ownedScheduler.get(), std::memory_order_release);
+    }
+    return *ownedScheduler;
+}
+
+} // namespace
+
+void configureScheduler(const SchedulerSettings& settings) {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    requestedSettings = settings;
+    activeScheduler.store(nullptr, std::memory_order_release);
+    ownedScheduler.reset();
+}
+
+SchedulerSettings schedulerSettings() {
+    return scheduler().settings();
+}
+
+size_t workerCount() {
+    return scheduler().settings().workers;
+}
+
+void setWorkerCount(size_t count) {
+    SchedulerSettings settings;
+    {
+        std::lock_guard<std::mutex> lock(schedulerMutex);
+        settings = requestedSettings;
+    }
+    settings.workers = count;
+    configureScheduler(settings);
+}
+
+bool deterministicScheduling() {
+    return scheduler().settings().deterministic;
+}
+
+void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (end <= begin) return;
+    Scheduler& pool = scheduler();
+    const SchedulerSettings& settings = pool.settings();
+    grain = std::max<size_t>(grain, 1);
+    size_t count = end - begin;
+
+    // Deterministic mode fixes the chunks at grain-sized blocks whatever the
+    // thread count; otherwise there are a few chunks per worker to steal
+    size_t chunks = (count + grain - 1) / grain;
+    if (!settings.deterministic) chunks = std::min(chunks, settings.workers * CHUNKS_PER_WORKER);
+    auto chunkBegin = [&](size_t c) {
+        return settings.deterministic ? begin + std::min(c * grain, count) : begin + count * c / chunks;
+    };
+    if (chunks <= 1) {
+        body(begin, end);
+        return;
+    }
+    if (settings.workers == 1) {
+        for (size_t c = 0; c < chunks; c++) body(chunkBegin(c), chunkBegin(c + 1));
+        return;
+    }
+
+    // Queue the far chunks so thieves take them first and the caller keeps the
+    // near ones in order. The queued chunks refer to this frame, so it waits for
+    // all of them even when a chunk throws, and then rethrows the first exception.
+    std::atomic<size_t> pending(chunks - 1);
+    TaskFailure failure;
+    for (size_t c = chunks - 1; c >= 1; c--) {
+        size_t first = chunkBegin(c), last = chunkBegin(c + 1);
+        pool.submit([&body, &pending, &failure, first, last] {
+            try {
+                if (!failure.failed.load(std::memory_order_acquire)) body(first, last);
+            } catch (...) {
+                failure.capture();
+            }
+            pending.fetch_sub(1, std::memory_order_release);
+        });
+    }
+    try {
+        body(chunkBegin(0), chunkBegin(1));
+    } catch (...) {
+        failure.capture();
+    }
+    pool.waitFor(pending);
+    failure.rethrow();
+}
+
+size_t TaskGraph::add(std::function<void()> task, const std::vector<size_t>& dependsOn) {
+    size_t id = nodes_.size();
+
+    // Dependencies can only name tasks added earlier, so the graph is always acyclic.
+    // Anything else is a caller bug; skipping it would run the task too early.
+    for (size_t dependency : dependsOn) {
+        if (dependency >= id) {
+            throw std::invalid_argument("TaskGraph task " + std::to_string(id) + " depends on task " +
+                std::to_string(dependency) + ", which has not been added yet");
+        }
+    }
+
+    nodes_.push_back(std::make_unique<Node>());
+    Node& node = *nodes_.back();
+    node.task = std::move(task);
+    for (size_t dependency : dependsOn) {
+        nodes_[dependency]->successors.push_back(id);
+        node.dependencies++;
+    }
+    return id;
+}
+
+// Structure to hold the progress of one TaskGraph::run call
+struct TaskGraph::RunState {
+    std::atomic<size_t> pending;
+    TaskFailure failure;
+};
+
+void TaskGraph::launch(size_t id, RunState& state) {
+    scheduler().submit([this, id, &state] {
+        // After a task throws, the rest are released without running, since they may depend on it
+        Node& node = *nodes_[id];
+        try {
+            if (!state.failure.failed.load(std::memory_order_acquire)) node.task();
+        } catch (...) {
+            state.failure.capture();
+        }
+        for (size_t successor : node.successors) {
+            if (nodes_[successor]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) launch(successor, state);
+        }
+        state.pending.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+void TaskGraph::run() {
+    if (nodes_.empty()) return;
+    RunState state;
+    state.pending.store(nodes_.size());
+    for (const std::unique_ptr<Node>& node : nodes_) node->remaining.store(node->dependencies);
+    for (size_t id = 0; id < nodes_.size(); id++) {
+        if (nodes_[id]->dependencies == 0) launch(id, state);
+    }
+    scheduler().waitFor(state.pending);
+    state.failure.rethrow();
+}
@@ -0,0 +1,97 @@
+// Parallel.h : Work-stealing task scheduler and the fork-join helpers built on
+// it, used to spread per-body loops and independent per-step passes across cores.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Structure to hold scheduler configuration
+struct SchedulerSettings {
+    size_t workers = 0;         // Threads including the caller; 0 uses every hardware thread
+    bool pinThreads = false;    // Pin worker i to core i so per-body ranges keep their caches
+    bool deterministic = false; // Split ranges into fixed grain-sized blocks, independent of the
+                                // worker count, so results are bit-identical for any thread count
+};
+
+// Function to replace the scheduler's configuration. Must not be called while
+// parallel work is running; the worker threads are restarted.
+void configureScheduler(const SchedulerSettings& settings);
+
+// Function to return the active configuration, with workers resolved to a real count
+SchedulerSettings schedulerSettings();
+
+// Function to return the number of threads parallel loops may use (at least 1)
+size_t workerCount();
+
+// Function to override the worker count; 0 restores the hardware default
+void setWorkerCount(size_t count);
+
+// Function to return whether the scheduler is in deterministic mode
+bool deterministicScheduling();
+
+// Function to run body(chunkBegin, chunkEnd) over [begin, end) split into contiguous
+// chunks of at least grain items. Chunks go onto the calling worker's deque and
+// idle workers steal them; the caller takes part and the call returns once
+// every chunk has finished. In deterministic mode every chunk is exactly one
+// grain-sized block (the last may be shorter). If a chunk throws, chunks not yet
+// started are skipped and the first exception is rethrown once the rest finish.
+void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+// Function to reduce over [begin, end): map(blockBegin, blockEnd) produces a
+// partial result per block and combine folds them in block order. Blocks are
+// grain-sized in deterministic mode, so the result does not depend on the
+// number of threads.
+template <typename T, typename Map, typename Combine>
+T parallelReduce(size_t begin, size_t end, size_t grain, T identity, const Map& map, const Combine& combine) {
+    if (end <= begin) return identity;
+    grain = grain > 0 ? grain : 1;
+    size_t count = end - begin;
+    size_t blocks = (count + grain - 1) / grain;
+    if (!deterministicScheduling()) blocks = blocks < workerCount() * 4 ? blocks : workerCount() * 4;
+
+    std::vector<T> partials(blocks, identity);
+    parallelFor(0, blocks, 1, [&](size_t first, size_t last) {
+        for (size_t b = first; b < last; b++) {
+            partials[b] = map(begin + count * b / blocks, begin + count * (b + 1) / blocks);
+        }
+    });
+    T result = identity;
+    for (const T& partial : partials) result = combine(result, partial);
+    return result;
+}
+
+// A set of tasks with dependencies, run on the scheduler. Tasks whose
+// dependencies have finished run concurrently.
+class TaskGraph {
+public:
+    // Function to add a task that starts once every task in dependsOn has finished; returns its id.
+    // dependsOn may only name tasks already added; anything else throws std::invalid_argument.
+    size_t add(std::function<void()> task, const std::vector<size_t>& dependsOn = {});
+
+    // Function to run every task and return when all have finished. The caller
+    // runs tasks too. The graph can be run again. If a task throws, tasks not yet
+    // started are skipped and the first exception is rethrown.
+    void run();
+
+    void clear() { nodes_.clear(); }
+    size_t size() const { return nodes_.size(); }
+
+private:
+    // Structure to hold a task and its place in the graph
+    struct Node {
+        std::function<void()> task;
+        std::vector<size_t> successors;
+        size_t dependencies = 0;
+        std::atomic<size_t> remaining{0};   // Unfinished dependencies during run()
+    };
+
+    struct RunState;
+
+    void launch(size_t node, RunState& state);
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+};
@@ -0,0 +1,17 @@
+// Planets.cpp : Built-in planet table.
+//
+#include "Planets.h"
+#include "SolarSystemSimulation.h"
+
+// Create planets with semi-major axis, eccentricity, orbital period, size, color, name, and mass
+const std::vector<Planet> planets = {
+    Planet(0.4f * SCALE, 0.205f, 0.24f, 0.015f, 1.0f, 0.0f, 0.0f, "Mercury", 1.66e-7f),
+    Planet(0.7f * SCALE, 0.007f, 0.62f, 0.02f, 1.0f, 1.0f, 1.0f, "Venus", 2.45e-6f),
+    Planet(1.0f * SCALE, 0.017f, 1.0f, 0.025f, 0.0f, 0.0f, 1.0f, "Earth", 3.00e-6f),
+    Planet(1.5f * SCALE, 0.093f, 1.88f, 0.02f, 1.0f, 0.0f, 0.0f, "Mars", 3.23e-7f),
+    Planet(2.8f * SCALE, 0.048f, 11.86f, 0.04f, 1.0f, 0.5f, 0.0f, "Jupiter", 9.55e-4f),
+    Planet(3.5f * SCALE, 0.056f, 29.45f, 0.035f, 1.0f, 1.0f, 0.5f, "Saturn", 2.86e-4f),
+    Planet(4.0f * SCALE, 0.046f, 84.02f, 0.03f, 0.0f, 0.5f, 1.0f, "Uranus", 4.37e-5f),
+    Planet(4.5f * SCALE, 0.010f, 164.79f, 0.03f, 0.0f, 0.0f, 1.0f, "Neptune", 5.15e-5f),
+    Planet(5.9f * SCALE, 0.249f, 248.0f, 0.02f, 0.8f, 0.8f, 0.8f, "Pluto", 6.6e-9f)  // Adding Pluto with its parameters
+};
@@ -0,0 +1,24 @@
+// Planets.h : Built-in planet table, loaded through makeDefaultCatalog().
+
+#pragma once
+
+#include <vector>
+
+// Structure to hold planet data
+struct Planet {
+    float semiMajorAxis; // Semi-major axis of the orbit
+    float eccentricity;  // Eccentricity of the orbit
+    float orbitalPeriod; // Orbital period (speed modifier)
+    float size;          // Visual size of the planet
+    float r, g, b;       // Color of the planet
+    const char* name;    // Name of the planet
+    float mass;          // Mass in solar masses (used by the N-body mode)
+
+    // Constructor to initialize all members
+    Planet(float semiMajorAxis, float eccentricity, float orbitalPeriod, float size, float r, float g, float b, const char* name, float mass)
+        : semiMajorAxis(semiMajorAxis), eccentricity(eccentricity), orbitalPeriod(orbitalPeriod), size(size),
+        r(r), g(g), b(b), name(name), mass(mass) {}
+};
+
+// Planets with semi-major axis, eccentricity, orbital period, size, color, name, and mass
+extern const std::vector<Planet> planets;
@@ -0,0 +1,246 @@
+// Profiler.cpp : Per-thread timer buffers, frame statistics and trace export.
+//
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+std::atomic<bool> profilingActive(false);
+
+namespace {
+
+// Structure to hold one timed scope
+struct TraceEvent {
+    const char* name;
+    int64_t start, end;
+};
+
+// Structure to hold one thread's totals for a stage
+struct StageTotals {
+    const char* name;
+    uint64_t count;
+    int64_t total, min, max;
+};
+
+// Structure to hold everything one thread recorded. Only the owning thread
+// writes it, so timers never take a lock.
+struct ThreadProfile {
+    uint32_t id;
+    std::vector<TraceEvent> events;
+    std::vector<StageTotals> stages;    // A handful of stages, searched linearly
+};
+
+// Profiles outlive their threads, so pool restarts keep what the old workers recorded
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadProfile>> threadProfiles;
+
+std::mutex frameMutex;
+std::vector<double> frameTimes;
+
+std::atomic<uint64_t> newtonCounts[NEWTON_HISTOGRAM_SIZE];
+
+// Function to return the calling thread's profile, registering it on first use
+ThreadProfile& threadProfile() {
+    thread_local ThreadProfile* profile = nullptr;
+    if (!profile) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threadProfiles.push_back(std::make_unique<ThreadProfile>());
+        profile = threadProfiles.back().get();
+        profile->id = static_cast<uint32_t>(threadProfiles.size() - 1);
+    }
+    return *profile;
+}
+
+// Function to return the value below which the given fraction of sorted values fall
+double percentile(const std::vector<double>& sorted, double fraction) {
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Function to write a string as a JSON literal
+void writeJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+void setProfiling(bool enabled) {
+    profilingActive.store(enabled, std::memory_order_relaxed);
+}
+
+void resetProfile() {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const std::unique_ptr<ThreadProfile>& profile : threadProfiles) {
+            profile->events.clear();
+            profile->stages.clear();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        frameTimes.clear();
+    }
+    for (std::atomic<uint64_t>& count : newtonCounts) count.store(0, std::memory_order_relaxed);
+}
+
+int64_t ScopedTimer::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ScopedTimer::record(const char* name, int64_t start, int64_t end) {
+    ThreadProfile& profile = threadProfile();
+    if (profile.events.size() < MAX_TRACE_EVENTS_PER_THREAD) profile.events.push_back({ name, start, end });
+
+    int64_t elapsed = end - start;
+    for (StageTotals& stage : profile.stages) {
+        if (stage.name == name) {
+            stage.count++;
+            stage.total += elapsed;
+            stage.min = std::min(stage.min, elapsed);
+            stage.max = std::max(stage.max, elapsed);
+            return;
+        }
+    }
+    profile.stages.push_back({ name, 1, elapsed, elapsed, elapsed });
+}
+
+std::vector<StageStats> stageStats() {
+    // The same stage can be timed from several threads and translation units
+    std::map<std::string, StageStats> merged;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const std::unique_ptr<ThreadProfile>& profile : threadProfiles) {
+            for (const StageTotals& totals : profile->stages) {
+                StageStats& stage = merged[totals.name];
+                double minSeconds = static_cast<double>(totals.min) * 1e-9;
+                double maxSeconds = static_cast<double>(totals.max) * 1e-9;
+                stage.minSeconds = stage.count == 0 ? minSeconds : std::min(stage.minSeconds, minSeconds);
+                stage.maxSeconds = std::max(stage.maxSeconds, maxSeconds);
+                stage.count += totals.count;
+                stage.totalSeconds += static_cast<double>(totals.total) * 1e-9;
+            }
+        }
+    }
+    std::vector<StageStats> stages;
+    for (auto& entry : merged) {
+        entry.second.name = entry.first;
+        stages.push_back(entry.second);
+    }
+    std::sort(stages.begin(), stages.end(), [](const StageStats& a, const StageStats& b) { return a.totalSeconds > b.totalSeconds; });
+    return stages;
+}
+
+void recordFrameTime(double seconds) {
+    if (!profilingEnabled()) return;
+    std::lock_guard<std::mutex> lock(frameMutex);
+    frameTimes.push_back(seconds);
+}
+
+FramePercentiles framePercentiles() {
+    std::vector<double> sorted;
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        sorted = frameTimes;
+    }
+    FramePercentiles result;
+    result.frames = sorted.size();
+    if (sorted.empty()) return result;
+    std::sort(sorted.begin(), sorted.end());
+    result.p50 = percentile(sorted, 0.50);
+    result.p90 = percentile(sorted, 0.90);
+    result.p99 = percentile(sorted, 0.99);
+    result.max = sorted.back();
+    return result;
+}
+
+void recordNewtonIterations(const uint64_t counts[NEWTON_HISTOGRAM_SIZE]) {
+    for (int k = 0; k < NEWTON_HISTOGRAM_SIZE; k++) {
+        if (counts[k]) newtonCounts[k].fetch_add(counts[k], std::memory_order_relaxed);
+    }
+}
+
+std::vector<uint64_t> newtonHistogram() {
+    std::vector<uint64_t> histogram(NEWTON_HISTOGRAM_SIZE);
+    for (int k = 0; k < NEWTON_HISTOGRAM_SIZE; k++) histogram[k] = newtonCounts[k].load(std::memory_order_relaxed);
+    return histogram;
+}
+
+bool writeChromeTrace(const std::string& path, std::string& error) {
+    std::ofstream out(path);
+    if (!out) {
+        error = "cannot create " + path;
+        return false;
+    }
+
+    // Complete ("X") events in microseconds from the earliest recorded scope
+    std::lock_guard<std::mutex> lock(registryMutex);
+    int64_t origin = INT64_MAX;
+    for (const std::unique_ptr<ThreadProfile>& profile : threadProfiles) {
+        for (const TraceEvent& event : profile->events) origin = std::min(origin, event.start);
+    }
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (const std::unique_ptr<ThreadProfile>& profile : threadProfiles) {
+        for (const TraceEvent& event : profile->events) {
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << profile->id
+                << ",\"ts\":" << static_cast<double>(event.start - origin) * 1e-3
+                << ",\"dur\":" << static_cast<double>(event.end - event.start) * 1e-3 << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        error = "failed writing " + path;
+        return false;
+    }
+    return true;
+}
+
+void printProfile(std::ostream& out) {
+    std::vector<StageStats> stages = stageStats();
+    if (!stages.empty()) {
+        size_t nameWidth = 22;
+        for (const StageStats& stage : stages) nameWidth = std::max(nameWidth, stage.name.size() + 2);
+        out << std::left << std::setw(static_cast<int>(nameWidth)) << "Stage" << std::right << std::setw(10) << "calls"
+            << std::setw(13) << "total ms" << std::setw(13) << "mean ms" << std::setw(13) << "max ms" << std::endl;
+        for (const StageStats& stage : stages) {
+            out << std::left << std::setw(static_cast<int>(nameWidth)) << stage.name << std::right << std::setw(10) << stage.count
+                << std::fixed << std::setprecision(3)
+                << std::setw(13) << stage.totalSeconds * 1e3
+                << std::setw(13) << stage.totalSeconds * 1e3 / static_cast<double>(stage.count)
+                << std::setw(13) << stage.maxSeconds * 1e3 << std::endl;
+        }
+        out.unsetf(std::ios::fixed);
+    }
+
+    FramePercentiles frames = framePercentiles();
+    if (frames.frames > 0) {
+        out << "Frames: " << frames.frames << ", p50 " << frames.p50 * 1e3 << " ms, p90 " << frames.p90 * 1e3
+            << " ms, p99 " << frames.p99 * 1e3 << " ms, max " << frames.max * 1e3 << " ms" << std::endl;
+    }
+
+    std::vector<uint64_t> histogram = newtonHistogram();
+    uint64_t groups = 0;
+    for (uint64_t count : histogram) groups += count;
+    if (groups > 0) {
+        out << "Newton iterations per lane group:";
+        for (int k = 0; k < NEWTON_HISTOGRAM_SIZE; k++) {
+            if (histogram[k]) out << " " << k + 1 << ":" << std::setprecision(3) << 100.0 * static_cast<double>(histogram[k]) / static_cast<double>(groups) << "%";
+        }
+        out << std::setprecision(6) << std::endl;
+    }
+}
@@ -0,0 +1,93 @@
+// Profiler.h : Low-overhead instrumentation for production runs. Scoped timers
+// feed per-stage totals and a Chrome trace, frames feed time percentiles, and
+// the Kepler kernels feed a histogram of Newton iterations. Everything is off
+// until setProfiling(true); a disabled timer costs one relaxed atomic load.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Cap on recorded trace events per thread, so long runs keep bounded memory.
+// Stage totals keep counting after a thread's trace is full.
+const size_t MAX_TRACE_EVENTS_PER_THREAD = 1 << 20;
+
+// Buckets in the Newton histogram: 1 .. KEPLER_ITERATIONS iterations
+const int NEWTON_HISTOGRAM_SIZE = 16;
+
+extern std::atomic<bool> profilingActive;
+
+// Function to turn recording on or off
+void setProfiling(bool enabled);
+
+inline bool profilingEnabled() {
+    return profilingActive.load(std::memory_order_relaxed);
+}
+
+// Function to discard every recorded timer, frame and iteration count. Call
+// while no timed work is running.
+void resetProfile();
+
+// Times the enclosing scope as one stage. name must outlive the profile, which
+// string literals do.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name) : name_(profilingEnabled() ? name : nullptr), start_(name_ ? now() : 0) {}
+    ~ScopedTimer() {
+        if (name_) record(name_, start_, now());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    // Function to return a monotonic timestamp in nanoseconds
+    static int64_t now();
+
+private:
+    static void record(const char* name, int64_t start, int64_t end);
+
+    const char* name_;
+    int64_t start_;
+};
+
+// Structure to hold the totals for one stage across every thread
+struct StageStats {
+    std::string name;
+    uint64_t count = 0;
+    double totalSeconds = 0.0;
+    double minSeconds = 0.0;
+    double maxSeconds = 0.0;
+};
+
+// Function to return per-stage totals, largest total first. Call while no
+// timed work is running.
+std::vector<StageStats> stageStats();
+
+// Function to record how long one frame (or any repeated unit of work) took
+void recordFrameTime(double seconds);
+
+// Structure to hold the distribution of recorded frame times
+struct FramePercentiles {
+    size_t frames = 0;
+    double p50 = 0.0, p90 = 0.0, p99 = 0.0, max = 0.0;   // Seconds
+};
+
+// Function to summarize the recorded frame times
+FramePercentiles framePercentiles();
+
+// Function to add a kernel call's Newton iteration counts; counts[k] is the
+// number of lane groups that finished after k + 1 iterations
+void recordNewtonIterations(const uint64_t counts[NEWTON_HISTOGRAM_SIZE]);
+
+// Function to return the Newton iteration histogram, indexed like recordNewtonIterations
+std::vector<uint64_t> newtonHistogram();
+
+// Function to write the recorded timers as Chrome trace JSON (chrome://tracing
+// or Perfetto). Call while no timed work is running.
+bool writeChromeTrace(const std::string& path, std::string& error);
+
+// Function to print stage totals, frame percentiles and the Newton histogram
+void printProfile(std::ostream& out);
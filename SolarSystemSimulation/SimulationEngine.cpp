@@ -0,0 +1,148 @@
+// SimulationEngine.cpp : Fixed-timestep stepping of the simulation core.
+//
+#include "SimulationEngine.h"
+#include "KeplerPropagator.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+// Slack so a target that is an exact multiple of the step is not lost to rounding
+const double STEP_EPSILON = 1e-9;
+
+// Bodies per propagation task. Ranges are cut on SIMD lane groups, so every
+// body goes through the same kernel path however the work is split.
+const size_t PROPAGATION_GRAIN = 16384;
+
+SimulationEngine::SimulationEngine(double timeStep)
+    : mode_(SimulationMode::Kepler), timeStep_(timeStep), stepIndex_(0) {}
+
+void SimulationEngine::setElements(const OrbitalElements& elements) {
+    mode_ = SimulationMode::Kepler;
+    elements_ = elements;
+    stepIndex_ = 0;
+    positions_.resize(elements_.size());
+    solvePositions(elements_, positions_, 0, elements_.size());
+}
+
+void SimulationEngine::enableNBody(const NBodySettings& settings, const std::vector<float>& masses) {
+    mode_ = SimulationMode::NBody;
+    initializeNBodySystem(nbody_, elements_, masses);
+    integrator_ = NBodyIntegrator(settings);
+    copyNBodyPositions();
+}
+
+void SimulationEngine::step(uint64_t count) {
+    ScopedTimer timer("step");
+    if (mode_ == SimulationMode::NBody) {
+        for (uint64_t i = 0; i < count; i++) {
+            integrator_.step(nbody_, timeStep_);
+        }
+        copyNBodyPositions();
+    } else {
+        const float deltaTime = static_cast<float>(timeStep_);
+        const size_t lanes = keplerLaneWidth();
+        const size_t bodies = elements_.size();
+        const size_t groups = (bodies + lanes - 1) / lanes;
+        parallelFor(0, groups, PROPAGATION_GRAIN / lanes, [&](size_t firstGroup, size_t lastGroup) {
+            size_t begin = firstGroup * lanes;
+            size_t end = std::min(lastGroup * lanes, bodies);
+            // Only the final positions are observable, so solve Kepler's equation once
+            advanceMeanAnomalies(elements_, deltaTime, count, begin, end);
+            solvePositions(elements_, positions_, begin, end);
+        });
+    }
+    stepIndex_ += count;
+    runPasses();
+}
+
+size_t SimulationEngine::addPass(std::function<void(const SimulationEngine&)> pass, const std::vector<size_t>& dependsOn) {
+    // Checked here rather than by the task graph, which is only built on the next step()
+    for (size_t dependency : dependsOn) {
+        if (dependency >= passes_.size()) {
+            throw std::invalid_argument("pass " + std::to_string(passes_.size()) + " depends on pass " +
+                std::to_string(dependency) + ", which has not been added yet");
+        }
+    }
+    passes_.push_back({ std::move(pass), dependsOn });
+    return passes_.size() - 1;
+}
+
+void SimulationEngine::clearPasses() {
+    passes_.clear();
+}
+
+void SimulationEngine::runPasses() {
+    if (passes_.empty()) return;
+    ScopedTimer timer("step passes");
+    if (passes_.size() == 1) {
+        passes_[0].run(*this);
+        return;
+    }
+    TaskGraph graph;
+    for (const Pass& pass : passes_) {
+        graph.add([this, &pass] { pass.run(*this); }, pass.dependsOn);
+    }
+    graph.run();
+}
+
+void SimulationEngine::copyNBodyPositions() {
+    positions_.resize(nbody_.size());
+    parallelFor(0, nbody_.size(), 65536, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            positions_.x[i] = static_cast<float>(nbody_.x[i]);
+            positions_.y[i] = static_cast<float>(nbody_.y[i]);
+        }
+    });
+}
+
+uint64_t SimulationEngine::advanceTo(double targetTime) {
+    uint64_t count = stepsUntil(targetTime);
+    if (count > 0) step(count);
+    return count;
+}
+
+uint64_t SimulationEngine::stepsUntil(double targetTime) const {
+    double remaining = (targetTime - time()) / timeStep_;
+    if (remaining < 1.0 - STEP_EPSILON) return 0;
+    return static_cast<uint64_t>(std::floor(remaining + STEP_EPSILON));
+}
+
+void SimulationEngine::snapshot(SimulationSnapshot& out) const {
+    out.time = time();
+    out.step = stepIndex_;
+    out.x.assign(positions_.x.begin(), positions_.x.end());
+    out.y.assign(positions_.y.begin(), positions_.y.end());
+}
+
+void SimulationEngine::saveState(SimulationState& out) const {
+    out.mode = mode_;
+    out.timeStep = timeStep_;
+    out.step = stepIndex_;
+    out.elements = elements_;
+    out.nbodySettings = integrator_.settings();
+    if (mode_ == SimulationMode::NBody) {
+        out.nbody = nbody_;
+    } else {
+        out.nbody.resize(0);
+    }
+}
+
+void SimulationEngine::restoreState(const SimulationState& state) {
+    mode_ = state.mode;
+    timeStep_ = state.timeStep;
+    stepIndex_ = state.step;
+    elements_ = state.elements;
+    if (mode_ == SimulationMode::NBody) {
+        // Cached accelerations are recomputed from the restored positions, which
+        // gives the same values the interrupted run had cached
+        nbody_ = state.nbody;
+        integrator_ = NBodyIntegrator(state.nbodySettings);
+        copyNBodyPositions();
+    } else {
+        positions_.resize(elements_.size());
+        solvePositions(elements_, positions_, 0, elements_.size());
+    }
+}
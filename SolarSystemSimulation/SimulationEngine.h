@@ -0,0 +1,113 @@
+// SimulationEngine.h : Headless, fixed-timestep simulation core. The viewer and
+// batch tools drive it and only ever read snapshots back.
+
+#pragma once
+
+#include "NBody.h"
+#include "OrbitalElements.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Default fixed step: one day, in simulated years
+const double DEFAULT_TIME_STEP = 1.0 / 365.25;
+
+// How bodies are moved each step
+enum class SimulationMode {
+    Kepler,     // Independent analytic ellipses around the Sun
+    NBody       // Numerical integration including body-body gravity
+};
+
+// Structure to hold a copy of the simulation state at one step
+struct SimulationSnapshot {
+    double time = 0.0;      // Simulated years since the start of the run
+    uint64_t step = 0;      // Number of fixed steps taken
+    std::vector<float> x;   // Heliocentric positions, indexed like OrbitalElements
+    std::vector<float> y;
+};
+
+// Structure to hold everything needed to resume a run exactly where it stopped
+struct SimulationState {
+    SimulationMode mode = SimulationMode::Kepler;
+    double timeStep = DEFAULT_TIME_STEP;
+    uint64_t step = 0;
+    OrbitalElements elements;       // Including the current mean anomalies
+    NBodySettings nbodySettings;    // N-body mode only
+    NBodySystem nbody;              // N-body mode only
+};
+
+class SimulationEngine {
+public:
+    explicit SimulationEngine(double timeStep = DEFAULT_TIME_STEP);
+
+    // Function to replace all bodies and rewind the clock to zero
+    void setElements(const OrbitalElements& elements);
+
+    // Function to switch to N-body integration starting from the current positions.
+    // masses holds solar masses for the first bodies; the rest become test particles.
+    // Orbital elements are no longer advanced while in this mode.
+    void enableNBody(const NBodySettings& settings, const std::vector<float>& masses);
+
+    // Function to advance exactly count fixed steps, then run the passes once.
+    // Bodies are split into ranges across the scheduler's workers; each range
+    // takes all count steps before moving on, so its elements stay in cache.
+    // In Kepler mode a range adds count steps to its mean anomalies and then
+    // solves Kepler's equation once, since only the final positions are visible.
+    void step(uint64_t count = 1);
+
+    // Function to add work that runs after every step() call, once the bodies
+    // have moved, such as statistics, snapshot output or collision checks.
+    // Passes run concurrently unless one is listed in another's dependsOn, and
+    // step() returns when all have finished. Returns an id for dependsOn, which
+    // may only name passes already added; anything else throws std::invalid_argument.
+    size_t addPass(std::function<void(const SimulationEngine&)> pass, const std::vector<size_t>& dependsOn = {});
+
+    // Function to remove every pass
+    void clearPasses();
+
+    // Function to take whole fixed steps until the clock reaches targetTime.
+    // Never overshoots; the remainder below one step is carried to the next call.
+    // Returns the number of steps taken.
+    uint64_t advanceTo(double targetTime);
+
+    // Function to return how many whole steps advanceTo(targetTime) would take
+    uint64_t stepsUntil(double targetTime) const;
+
+    // Function to copy the current state into a caller-owned snapshot, reusing its storage
+    void snapshot(SimulationSnapshot& out) const;
+
+    // Function to copy the full state for a checkpoint, reusing out's storage
+    void saveState(SimulationState& out) const;
+
+    // Function to continue from a saved state; later steps match the original run bit for bit
+    void restoreState(const SimulationState& state);
+
+    double time() const { return static_cast<double>(stepIndex_) * timeStep_; }
+    double timeStep() const { return timeStep_; }
+    uint64_t stepIndex() const { return stepIndex_; }
+    size_t bodyCount() const { return elements_.size(); }
+    SimulationMode mode() const { return mode_; }
+
+    const OrbitalElements& elements() const { return elements_; }
+    const BodyPositions& positions() const { return positions_; }
+    const NBodySystem& nbodySystem() const { return nbody_; }
+
+private:
+    void copyNBodyPositions();
+    void runPasses();
+
+    // Structure to hold a per-step pass and the passes it waits for
+    struct Pass {
+        std::function<void(const SimulationEngine&)> run;
+        std::vector<size_t> dependsOn;
+    };
+
+    SimulationMode mode_;
+    OrbitalElements elements_;
+    BodyPositions positions_;
+    NBodySystem nbody_;
+    NBodyIntegrator integrator_;
+    double timeStep_;
+    uint64_t stepIndex_;
+    std::vector<Pass> passes_;
+};
@@ -0,0 +1,302 @@
+// SolarSystemBenchmark.cpp : Timing harness for the simulation core. Covers the
+// Kepler solve across eccentricities, whole fixed steps at 1K to 10M bodies,
+// N-body forces with every body massive, and the viewer's orbit and body geometry.
+//
+#include "SolarSystemSimulation.h"
+#include "BodyCatalog.h"
+#include "DrawList.h"
+#include "KeplerPropagator.h"
+#include "NBody.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "SimulationEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Every case runs at least this many times after one untimed warm-up run,
+// and at most MAX_REPETITIONS however short it is
+const size_t MIN_REPETITIONS = 5;
+const size_t MAX_REPETITIONS = 10000;
+
+// Bodies solved per Kepler case, sized to spill out of the caches like a real population
+const size_t KEPLER_BATCH = 1 << 20;
+const size_t QUICK_KEPLER_BATCH = 1 << 16;
+
+// Bodies whose orbits are drawn in the geometry cases
+const size_t DRAWN_ORBITS = 10000;
+
+// Solar masses of each asteroid in the force cases, so every body is a source
+const float FORCE_ASTEROID_MASS = 1e-12f;
+
+// Largest population for direct summation, which is O(N^2), and for any force case with --quick
+const size_t MAX_DIRECT_BODIES = 10000;
+const size_t QUICK_FORCE_BODIES = 100000;
+
+// Structure to hold parsed command-line options
+struct BenchmarkOptions {
+    double minSeconds = 1.0;        // Keep repeating each case for at least this long
+    size_t maxBodies = 10000000;    // Skip full-step cases larger than this
+    bool quick = false;             // Smaller batches and no 10M case, for a smoke run
+    std::string tracePath;          // Profile every timed run and write it as a Chrome trace here
+    SchedulerSettings scheduler;
+};
+
+// Structure to hold one Kepler case
+struct EccentricityCase {
+    const char* name;
+    float eccentricity;
+};
+
+// Circular through near-parabolic; Newton needs more iterations as e approaches 1
+const EccentricityCase ECCENTRICITY_CASES[] = {
+    { "circular", 0.0f },
+    { "Earth", 0.0167f },
+    { "Pluto", 0.249f },
+    { "e 0.5", 0.5f },
+    { "e 0.9", 0.9f },
+    { "e 0.99", 0.99f },
+    { "near-parabolic", 0.999f },
+};
+
+// Timer names must outlive the profile, so case names are kept here for the whole run
+std::deque<std::string> caseNames;
+
+// Function to print usage information
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+        << "  --min-time <s>    Repeat each case for at least s seconds (default 1)\n"
+        << "  --max-bodies <n>  Skip full-step cases above n bodies (default 10000000)\n"
+        << "  --quick           Short runs with smaller batches, up to 1M bodies (100K for forces)\n"
+        << "  --trace <file>    Profile every timed run and write it as a Chrome trace\n"
+        << "  --threads <n>     Worker threads including the main one (default: all cores)\n"
+        << "  --pin             Pin each worker thread to its own core\n";
+}
+
+// Function to parse arguments; returns false on malformed input
+bool parseOptions(int argc, char** argv, BenchmarkOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--min-time") == 0 && hasValue) options.minSeconds = std::atof(argv[++i]);
+        else if (strcmp(arg, "--max-bodies") == 0 && hasValue) options.maxBodies = std::strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--quick") == 0) {
+            options.quick = true;
+            options.minSeconds = 0.2;
+            options.maxBodies = std::min<size_t>(options.maxBodies, 1000000);
+        }
+        else if (strcmp(arg, "--trace") == 0 && hasValue) options.tracePath = argv[++i];
+        else if (strcmp(arg, "--threads") == 0 && hasValue) options.scheduler.workers = std::strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--pin") == 0) options.scheduler.pinThreads = true;
+        else return false;
+    }
+    return options.minSeconds >= 0.0;
+}
+
+// Function to time work until it has run MIN_REPETITIONS times and for at least
+// minSeconds, and print per-run and per-item timings. setup runs untimed before
+// every run, for cases that must start cold.
+void runCase(const std::string& name, size_t items, const BenchmarkOptions& options,
+    const std::function<void()>& work, const std::function<void()>& setup = nullptr) {
+    caseNames.push_back(name);
+    const char* label = caseNames.back().c_str();
+
+    if (setup) setup();
+    work();
+
+    std::vector<double> samples;
+    int64_t started = ScopedTimer::now();
+    while (samples.size() < MIN_REPETITIONS ||
+        (static_cast<double>(ScopedTimer::now() - started) * 1e-9 < options.minSeconds && samples.size() < MAX_REPETITIONS)) {
+        if (setup) setup();
+        int64_t start = ScopedTimer::now();
+        {
+            ScopedTimer timer(label);
+            work();
+        }
+        samples.push_back(static_cast<double>(ScopedTimer::now() - start) * 1e-9);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double median = samples[samples.size() / 2];
+    double p99 = samples[std::min(samples.size() - 1, static_cast<size_t>(0.99 * static_cast<double>(samples.size() - 1) + 0.5))];
+    std::cout << std::left << std::setw(40) << name << std::right << std::setw(7) << samples.size()
+        << std::fixed << std::setprecision(3)
+        << std::setw(12) << median * 1e3 << std::setw(12) << samples.front() * 1e3 << std::setw(12) << p99 * 1e3
+        << std::setprecision(2) << std::setw(12) << median * 1e9 / static_cast<double>(items) << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+}
+
+// Function to print the Newton iterations added to the histogram since before
+void printNewtonDelta(const std::vector<uint64_t>& before) {
+    std::vector<uint64_t> after = newtonHistogram();
+    uint64_t groups = 0;
+    double iterations = 0.0;
+    for (int k = 0; k < NEWTON_HISTOGRAM_SIZE; k++) {
+        after[k] -= before[k];
+        groups += after[k];
+        iterations += static_cast<double>(after[k]) * (k + 1);
+    }
+    if (groups == 0) return;
+    std::cout << "    Newton iterations per lane group, mean " << std::setprecision(3) << iterations / static_cast<double>(groups) << ":";
+    for (int k = 0; k < NEWTON_HISTOGRAM_SIZE; k++) {
+        if (after[k]) std::cout << " " << k + 1 << ":" << 100.0 * static_cast<double>(after[k]) / static_cast<double>(groups) << "%";
+    }
+    std::cout << std::setprecision(6) << std::endl;
+}
+
+// Function to time the batch solve against the libm reference for one eccentricity
+void benchmarkKepler(const EccentricityCase& eccentricityCase, size_t count, const BenchmarkOptions& options) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> angle(0.0f, TWO_PI);
+    OrbitalElements elements;
+    elements.resize(count);
+    for (size_t i = 0; i < count; i++) elements.set(i, 1.0f, eccentricityCase.eccentricity, 1.0f, angle(rng), angle(rng));
+    BodyPositions positions;
+    positions.resize(count);
+
+    runCase(std::string("kepler ") + keplerBackendName() + ", " + eccentricityCase.name, count, options,
+        [&] { solvePositions(elements, positions, 0, count); });
+
+    // Iterations are only counted while profiling, so they come from one more untimed solve
+    bool tracing = profilingEnabled();
+    setProfiling(true);
+    std::vector<uint64_t> before = newtonHistogram();
+    solvePositions(elements, positions, 0, count);
+    printNewtonDelta(before);
+    setProfiling(tracing);
+
+    // Single-precision error against the double-precision solver, in units of the semi-major axis
+    double maxError = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double x, y;
+        keplerPositionAt(elements, i, 0.0, x, y);
+        maxError = std::max(maxError, std::hypot(positions.x[i] - x, positions.y[i] - y));
+    }
+    std::cout << "    max position error " << maxError << std::endl;
+
+    volatile float sink = 0.0f;
+    runCase(std::string("kepler reference, ") + eccentricityCase.name, count, options, [&] {
+        float sum = 0.0f;
+        for (size_t i = 0; i < count; i++) sum += solveKeplerReference(elements.meanAnomaly[i], elements.eccentricity[i]);
+        sink = sum;
+    });
+}
+
+// Function to build the planets plus enough belt asteroids to reach count bodies
+void makeBenchmarkCatalog(BodyCatalog& catalog, size_t count) {
+    makeDefaultCatalog(catalog, 1);
+    if (count > catalog.size()) addAsteroidBelt(catalog, count - catalog.size(), 1);
+}
+
+// Function to time one fixed step of the whole population
+void benchmarkStep(size_t count, const BenchmarkOptions& options) {
+    SimulationEngine engine;
+    {
+        BodyCatalog catalog;
+        makeBenchmarkCatalog(catalog, count);
+        engine.setElements(catalog.elements);
+    }
+    runCase("step, " + std::to_string(count) + " bodies", engine.bodyCount(), options, [&] { engine.step(1); });
+}
+
+// Function to time one evaluation of mutual accelerations with every body massive
+void benchmarkForces(size_t count, ForceMethod method, const BenchmarkOptions& options) {
+    NBodySystem system;
+    {
+        BodyCatalog catalog;
+        makeDefaultCatalog(catalog, 1);
+        if (count > catalog.size()) addAsteroidBelt(catalog, count - catalog.size(), 1, FORCE_ASTEROID_MASS);
+        initializeNBodySystem(system, catalog.elements, catalog.masses);
+    }
+    NBodySettings settings;
+    settings.method = method;
+    NBodyIntegrator integrator(settings);
+    std::vector<double> ax, ay;
+    runCase(std::string(method == ForceMethod::Direct ? "forces direct, " : "forces Barnes-Hut, ") +
+        std::to_string(count) + " sources", count, options, [&] { integrator.computeAccelerations(system, false, ax, ay); });
+}
+
+// Function to time orbit polyline generation and the per-frame draw list
+void benchmarkGeometry(size_t count, const BenchmarkOptions& options) {
+    BodyCatalog catalog;
+    makeBenchmarkCatalog(catalog, count);
+    size_t orbits = 0;
+    for (BodyStyle& style : catalog.styles) {
+        if (orbits < DRAWN_ORBITS) style.flags |= STYLE_DRAW_ORBIT;
+        if (style.flags & STYLE_DRAW_ORBIT) orbits++;
+    }
+
+    SimulationEngine engine;
+    engine.setElements(catalog.elements);
+    SimulationSnapshot snapshot;
+    engine.snapshot(snapshot);
+
+    DrawListBuilder builder;
+    ViewBounds view = makeViewBounds(VIEW_WIDTH_PIXELS, VIEW_HEIGHT_PIXELS, 1.0f, 0.0f, 0.0f);
+    runCase("orbit cache, " + std::to_string(orbits) + " orbits (cold)", orbits, options,
+        [&] { builder.build(snapshot, view); }, [&] { builder.setBodies(catalog); });
+
+    for (float zoom : { 1.0f, 8.0f }) {
+        view = makeViewBounds(VIEW_WIDTH_PIXELS, VIEW_HEIGHT_PIXELS, zoom, 0.0f, 0.0f);
+        std::ostringstream name;
+        name << "draw list, " << count << " bodies, zoom " << zoom;
+        runCase(name.str(), count, options, [&] { builder.build(snapshot, view); });
+        const DrawStats& stats = builder.stats();
+        std::cout << "    " << stats.drawCalls << " draw calls, " << stats.vertices << " vertices, "
+            << stats.culledBodies << " bodies and " << stats.culledOrbits << " orbits culled" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    configureScheduler(options.scheduler);
+    // Timers stay off unless a trace was asked for, so they do not skew the timings
+    bool tracing = !options.tracePath.empty();
+    setProfiling(tracing);
+
+    std::cout << "Kepler backend " << keplerBackendName() << ", " << workerCount() << " worker(s)" << std::endl;
+    std::cout << std::left << std::setw(40) << "Case" << std::right << std::setw(7) << "runs"
+        << std::setw(12) << "median ms" << std::setw(12) << "min ms" << std::setw(12) << "p99 ms" << std::setw(12) << "ns/item" << std::endl;
+
+    size_t keplerBatch = options.quick ? QUICK_KEPLER_BATCH : KEPLER_BATCH;
+    for (const EccentricityCase& eccentricityCase : ECCENTRICITY_CASES) benchmarkKepler(eccentricityCase, keplerBatch, options);
+
+    for (size_t count : { size_t(1000), size_t(1000000), size_t(10000000) }) {
+        if (count <= options.maxBodies) benchmarkStep(count, options);
+    }
+
+    size_t maxForceBodies = options.quick ? std::min(options.maxBodies, QUICK_FORCE_BODIES) : options.maxBodies;
+    for (size_t count : { size_t(10000), size_t(100000), size_t(1000000) }) {
+        if (count <= maxForceBodies && count <= MAX_DIRECT_BODIES) benchmarkForces(count, ForceMethod::Direct, options);
+        if (count <= maxForceBodies) benchmarkForces(count, ForceMethod::BarnesHut, options);
+    }
+
+    benchmarkGeometry(std::min<size_t>(options.maxBodies, 1000000), options);
+
+    if (tracing) {
+        setProfiling(false);
+        std::cout << std::endl;
+        printProfile(std::cout);
+        std::string error;
+        if (!writeChromeTrace(options.tracePath, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote trace to " << options.tracePath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,462 @@
+// SolarSystemHeadless.cpp : Command-line entry point that runs the simulation
+// core without a window, as fast as the CPU allows.
+//
+#include "SolarSystemSimulation.h"
+#include "SimulationEngine.h"
+#include "BodyCatalog.h"
+#include "CloseApproach.h"
+#include "DrawList.h"
+#include "Ephemeris.h"
+#include "KeplerPropagator.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "Trajectory.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+// Steps per stretch when no trajectory is recorded, about a simulated year at
+// the default step. Long stretches keep Kepler runs on one solve per stretch,
+// like an unprofiled run, while a profile still has a series of stretches to time.
+const uint64_t UNRECORDED_STRETCH_STEPS = 365;
+
+// Structure to hold parsed command-line options
+struct HeadlessOptions {
+    double years = 100.0;                // Simulated time to propagate
+    double timeStep = DEFAULT_TIME_STEP; // Fixed step in simulated years
+    size_t asteroids = 0;                // Synthetic belt bodies added after the planets
+    float asteroidMass = 0.0f;           // Solar masses of each synthetic asteroid
+    unsigned int seed = 0;               // Seed for initial anomalies (0 = time-based)
+    std::string catalogPath;             // Load bodies from this catalog instead of the planet table
+    std::string binaryPath;              // Write the loaded bodies as a binary catalog here
+    std::string recordPath;              // Stream positions to this trajectory file
+    uint64_t recordEvery = 1;            // Steps between recorded frames
+    TrajectorySettings trajectory;
+    std::string checkpointPath;          // Periodically save the full state here
+    double checkpointEvery = 1.0;        // Simulated years between checkpoints
+    std::string resumePath;              // Continue from this checkpoint
+    bool renderStats = false;            // Report what the viewer would submit for the final frame
+    float zoom = 1.0f;                   // Viewer zoom used for the render statistics
+    bool quiet = false;                  // Skip the final position table
+    bool stats = false;                  // Track the spread of heliocentric distances
+    float approach = 0.0f;               // Report pairs closer than this after every step (0 = off)
+    std::string profilePath;             // Time every stage and write a Chrome trace here
+    std::string queryPath;               // Look positions up in this trajectory instead of running
+    double queryTime = NAN;              // Simulated years to look up with --query
+    std::vector<size_t> queryBodies;     // Bodies to look up (default: the first few)
+    SchedulerSettings scheduler;
+    bool nbody = false;                  // Integrate mutual gravity instead of fixed ellipses
+    NBodySettings nbodySettings;
+};
+
+// Function to print usage information
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+        << "  --years <y>       Simulated years to propagate (default 100)\n"
+        << "  --dt <years>      Fixed time step in years (default 1 day)\n"
+        << "  --asteroids <n>   Add n synthetic main-belt asteroids\n"
+        << "  --asteroid-mass <m>  Give each synthetic asteroid m solar masses, so --nbody feels its pull (default 0)\n"
+        << "  --seed <s>        Seed for initial anomalies (default: time-based)\n"
+        << "  --catalog <file>  Load bodies from an MPCORB, SBDB CSV or binary catalog\n"
+        << "  --write-binary <file>  Save the bodies as a binary catalog before running\n"
+        << "  --record <file>   Stream positions to a trajectory file\n"
+        << "  --record-every <n>  Steps between recorded frames (default 1)\n"
+        << "  --raw             Store float32 positions instead of delta-quantized ones\n"
+        << "  --quantize <q>    Position resolution for delta-quantized frames (default 1e-5)\n"
+        << "  --buffer <n>      Frames queued between stepping and the trajectory writer (default 16)\n"
+        << "  --lossy           Drop frames instead of waiting when the trajectory writer falls behind\n"
+        << "                    (ignored with --deterministic)\n"
+        << "  --checkpoint <file>  Save the full state periodically and at the end\n"
+        << "  --checkpoint-every <y>  Simulated years between checkpoints (default 1)\n"
+        << "  --resume <file>   Continue from a checkpoint up to --years in total\n"
+        << "  --render-stats    Count the viewer's draw calls and vertices for the final frame\n"
+        << "  --zoom <z>        Viewer zoom level for --render-stats (default 1)\n"
+        << "  --quiet           Do not print final planet positions\n"
+        << "  --stats           Report the min, mean and max heliocentric distance\n"
+        << "  --approach <d>    Report bodies passing within d scene units of each other\n"
+        << "  --profile <file>  Print per-stage and per-stretch timings and write a Chrome trace\n"
+        << "  --query <file>    Print positions and velocities from a recorded trajectory, then exit\n"
+        << "  --at <years>      Simulated time to look up with --query\n"
+        << "  --body <i>        Body to look up with --query; repeat for more (default: the first 9)\n"
+        << "  --threads <n>     Worker threads including the main one (default: all cores)\n"
+        << "  --pin             Pin each worker thread to its own core\n"
+        << "  --deterministic   Split work in fixed blocks so results match for any --threads\n"
+        << "  --nbody           Integrate mutual gravity; massless asteroids are test particles\n"
+        << "  --direct          Use O(N^2) direct summation instead of Barnes-Hut\n"
+        << "  --leapfrog        Use plain leapfrog instead of the Wisdom-Holman split\n"
+        << "  --theta <t>       Barnes-Hut opening angle (default 0.5)\n";
+}
+
+// Function to parse arguments; returns false on malformed input
+bool parseOptions(int argc, char** argv, HeadlessOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--years") == 0 && hasValue) options.years = std::atof(argv[++i]);
+        else if (strcmp(arg, "--dt") == 0 && hasValue) options.timeStep = std::atof(argv[++i]);
+        else if (strcmp(arg, "--asteroids") == 0 && hasValue) options.asteroids = std::strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--asteroid-mass") == 0 && hasValue) options.asteroidMass = static_cast<float>(std::atof(argv[++i]));
+        else if (strcmp(arg, "--seed") == 0 && hasValue) options.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(arg, "--catalog") == 0 && hasValue) options.catalogPath = argv[++i];
+        else if (strcmp(arg, "--write-binary") == 0 && hasValue) options.binaryPath = argv[++i];
+        else if (strcmp(arg, "--record") == 0 && hasValue) options.recordPath = argv[++i];
+        else if (strcmp(arg, "--record-every") == 0 && hasValue) options.recordEvery = std::strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--raw") == 0) options.trajectory.encoding = TrajectoryEncoding::Raw;
+        else if (strcmp(arg, "--quantize") == 0 && hasValue) options.trajectory.quantization = std::atof(argv[++i]);
+        else if (strcmp(arg, "--buffer") == 0 && hasValue) options.trajectory.bufferFrames = std::strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--lossy") == 0) options.trajectory.blocking = false;
+        else if (strcmp(arg, "--checkpoint") == 0 && hasValue) options.checkpointPath = argv[++i];
+        else if (strcmp(arg, "--checkpoint-every") == 0 && hasValue) options.checkpointEvery = std::atof(argv[++i]);
+        else if (strcmp(arg, "--resume") == 0 && hasValue) options.resumePath = argv[++i];
+        else if (strcmp(arg, "--render-stats") == 0) options.renderStats = true;
+        else if (strcmp(arg, "--zoom") == 0 && hasValue) options.zoom = static_cast<float>(std::atof(argv[++i]));
+        else if (strcmp(arg, "--quiet") == 0) options.quiet = true;
+        else if (strcmp(arg, "--stats") == 0) options.stats = true;
+        else if (strcmp(arg, "--approach") == 0 && hasValue) options.approach = static_cast<float>(std::atof(argv[++i]));
+        else if (strcmp(arg, "--profile") == 0 && hasValue) options.profilePath = argv[++i];
+        else if (strcmp(arg, "--query") == 0 && hasValue) options.queryPath = argv[++i];
+        else if (strcmp(arg, "--at") == 0 && hasValue) options.queryTime = std::atof(argv[++i]);
+        else if (strcmp(arg, "--body") == 0 && hasValue) options.queryBodies.push_back(std::strtoull(argv[++i], nullptr, 10));
+        else if (strcmp(arg, "--threads") == 0 && hasValue) options.scheduler.workers = std::strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--pin") == 0) options.scheduler.pinThreads = true;
+        else if (strcmp(arg, "--deterministic") == 0) options.scheduler.deterministic = true;
+        else if (strcmp(arg, "--nbody") == 0) options.nbody = true;
+        else if (strcmp(arg, "--direct") == 0) options.nbodySettings.method = ForceMethod::Direct;
+        else if (strcmp(arg, "--leapfrog") == 0) options.nbodySettings.scheme = IntegratorScheme::Leapfrog;
+        else if (strcmp(arg, "--theta") == 0 && hasValue) options.nbodySettings.openingAngle = std::atof(argv[++i]);
+        else return false;
+    }
+    return options.years >= 0.0 && options.timeStep > 0.0 && options.recordEvery > 0 && options.trajectory.bufferFrames > 0 &&
+        options.trajectory.quantization > 0.0 && options.checkpointEvery > 0.0 && options.zoom > 0.0f && options.approach >= 0.0f &&
+        options.asteroidMass >= 0.0f &&
+        (options.queryPath.empty() || std::isfinite(options.queryTime));
+}
+
+// Structure to hold the spread of heliocentric distances at one step
+struct RadiusStats {
+    float min = INFINITY;
+    float max = 0.0f;
+    double sum = 0.0;
+    size_t count = 0;
+};
+
+// Function to summarize the distances of every body from the Sun
+RadiusStats radiusStats(const BodyPositions& positions) {
+    return parallelReduce(0, positions.size(), 65536, RadiusStats(),
+        [&](size_t begin, size_t end) {
+            RadiusStats partial;
+            for (size_t i = begin; i < end; i++) {
+                float r = std::sqrt(positions.x[i] * positions.x[i] + positions.y[i] * positions.y[i]);
+                partial.min = std::min(partial.min, r);
+                partial.max = std::max(partial.max, r);
+                partial.sum += r;
+            }
+            partial.count = end - begin;
+            return partial;
+        },
+        [](const RadiusStats& a, const RadiusStats& b) {
+            RadiusStats combined;
+            combined.min = std::min(a.min, b.min);
+            combined.max = std::max(a.max, b.max);
+            combined.sum = a.sum + b.sum;
+            combined.count = a.count + b.count;
+            return combined;
+        });
+}
+
+// Function to name a body, falling back to its index for unnamed bodies and
+// bodies beyond the catalog (e.g. after --resume)
+std::string bodyLabel(const BodyCatalog& catalog, size_t i) {
+    if (i < catalog.size() && catalog.name(i)[0] != '\0') return catalog.name(i);
+    return "#" + std::to_string(i);
+}
+
+// Function to answer --query: fit an ephemeris to the chosen bodies over the
+// frames around the requested time and print their state there
+bool runQuery(const HeadlessOptions& options, const BodyCatalog& catalog) {
+    // Frames read on each side of the query time; the spline only needs a few,
+    // the rest lets the ephemeris fit whole segments without running off the end
+    const uint64_t QUERY_WINDOW_FRAMES = 64;
+
+    TrajectoryReader reader;
+    std::string error;
+    if (!reader.open(options.queryPath, error)) {
+        std::cerr << "Failed to open trajectory: " << error << std::endl;
+        return false;
+    }
+    if (reader.frameCount() == 0) {
+        std::cerr << "Trajectory " << options.queryPath << " holds no frames" << std::endl;
+        return false;
+    }
+    std::vector<size_t> bodies = options.queryBodies;
+    if (bodies.empty()) {
+        for (size_t i = 0; i < reader.bodyCount() && i < 9; i++) bodies.push_back(i);
+    }
+    for (size_t body : bodies) {
+        if (body >= reader.bodyCount()) {
+            std::cerr << "Body " << body << " is not in the trajectory (" << reader.bodyCount() << " bodies)" << std::endl;
+            return false;
+        }
+    }
+    double firstTime = reader.frameTime(0), lastTime = reader.frameTime(reader.frameCount() - 1);
+    if (options.queryTime < firstTime || options.queryTime > lastTime) {
+        std::cerr << "t = " << options.queryTime << " is outside the trajectory (" << firstTime << " to " << lastTime << " years)" << std::endl;
+        return false;
+    }
+
+    uint64_t nearest = 0;
+    reader.findFrame(options.queryTime, nearest);
+    uint64_t firstFrame = nearest > QUERY_WINDOW_FRAMES ? nearest - QUERY_WINDOW_FRAMES : 0;
+    uint64_t endFrame = std::min(reader.frameCount(), nearest + QUERY_WINDOW_FRAMES + 1);
+
+    // Delta-quantized frames are only known to the grid, so the fit stops refining there
+    double gridSpacing = reader.encoding() == TrajectoryEncoding::DeltaQuantized ? reader.quantization() : 0.0;
+    RecordedEphemerisSource source(bodies.size(), gridSpacing);
+    SimulationSnapshot frame;
+    std::vector<float> x(bodies.size()), y(bodies.size());
+    for (uint64_t f = firstFrame; f < endFrame; f++) {
+        if (!reader.readFrame(f, frame)) {
+            std::cerr << "Failed to read frame " << f << " of " << options.queryPath << std::endl;
+            return false;
+        }
+        for (size_t k = 0; k < bodies.size(); k++) {
+            x[k] = frame.x[bodies[k]];
+            y[k] = frame.y[bodies[k]];
+        }
+        source.recordPositions(frame.time, x.data(), y.data());
+    }
+
+    // Names only line up when the trajectory came from the same bodies
+    BodyCatalog unnamed;
+    const BodyCatalog& names = catalog.size() == reader.bodyCount() ? catalog : unnamed;
+    ChebyshevEphemeris ephemeris(source);
+    std::cout << "t = " << options.queryTime << " years, from frames " << firstFrame << " to " << endFrame - 1
+        << " of " << options.queryPath << std::endl;
+    for (size_t k = 0; k < bodies.size(); k++) {
+        double px, py, vx, vy;
+        ephemeris.state(k, options.queryTime, px, py, vx, vy);
+        std::cout << "  " << bodyLabel(names, bodies[k]) << ": " << px << ", " << py << " (velocity " << vx << ", " << vy << ")" << std::endl;
+    }
+    std::cout << "Largest fit residual " << ephemeris.maxFitError() << std::endl;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    HeadlessOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return -1;
+    }
+    configureScheduler(options.scheduler);
+    bool profiling = !options.profilePath.empty();
+    setProfiling(profiling);
+    if (options.seed == 0) options.seed = static_cast<unsigned int>(time(0));
+
+    BodyCatalog catalog;
+    std::string error;
+    if (options.catalogPath.empty()) {
+        makeDefaultCatalog(catalog, options.seed);
+    } else {
+        auto loadStart = std::chrono::steady_clock::now();
+        if (!loadCatalog(options.catalogPath, catalog, CatalogLoadOptions(), error)) {
+            std::cerr << "Failed to load catalog: " << error << std::endl;
+            return -1;
+        }
+        double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+        std::cout << "Loaded " << catalog.size() << " bodies in " << loadSeconds * 1000.0 << " ms" << std::endl;
+    }
+    addAsteroidBelt(catalog, options.asteroids, options.seed + 1, options.asteroidMass);
+    if (!options.queryPath.empty()) return runQuery(options, catalog) ? 0 : -1;
+
+    if (!options.binaryPath.empty() && !writeBinaryCatalog(options.binaryPath, catalog, error)) {
+        std::cerr << "Failed to write catalog: " << error << std::endl;
+        return -1;
+    }
+
+    SimulationEngine engine(options.timeStep);
+    if (options.resumePath.empty()) {
+        engine.setElements(catalog.elements);
+        if (options.nbody) engine.enableNBody(options.nbodySettings, catalog.masses);
+    } else {
+        // Bodies, mode and clock all come from the checkpoint; the catalog only supplies names
+        SimulationState state;
+        if (!readCheckpoint(options.resumePath, state, error)) {
+            std::cerr << "Failed to resume: " << error << std::endl;
+            return -1;
+        }
+        engine.restoreState(state);
+        if (!options.catalogPath.empty() && engine.bodyCount() != catalog.size()) {
+            std::cerr << "Failed to resume: " << options.resumePath << " holds " << engine.bodyCount()
+                << " bodies but the catalog has " << catalog.size() << std::endl;
+            return -1;
+        }
+        std::cout << "Resuming at t = " << engine.time() << " years (step " << engine.stepIndex() << ")" << std::endl;
+    }
+
+    TrajectoryWriter writer;
+    if (!options.recordPath.empty()) {
+        bool opened = !options.resumePath.empty() && std::filesystem::exists(options.recordPath)
+            ? writer.openForResume(options.recordPath, engine.stepIndex(), options.trajectory, error)
+            : writer.open(options.recordPath, engine.bodyCount(), engine.timeStep(), options.trajectory, error);
+        if (!opened) {
+            std::cerr << "Failed to open trajectory: " << error << std::endl;
+            return -1;
+        }
+    }
+
+    // Recording, statistics and close-approach screening are independent passes,
+    // so they run side by side after each stretch of steps
+    if (writer.isOpen()) {
+        engine.addPass([&](const SimulationEngine& stepped) {
+            if (stepped.stepIndex() % options.recordEvery == 0) writer.record(stepped);
+        });
+    }
+    RadiusStats radius;
+    if (options.stats) {
+        engine.addPass([&](const SimulationEngine& stepped) { radius = radiusStats(stepped.positions()); });
+    }
+    CloseApproachSettings approachSettings;
+    approachSettings.threshold = options.approach;
+    CloseApproachDetector approaches(approachSettings);
+    std::vector<CloseApproachEvent> approachEvents;
+    bool screening = options.approach > 0.0f;
+    if (screening) {
+        approaches.update(engine.positions(), engine.time(), approachEvents);
+        engine.addPass([&](const SimulationEngine& stepped) {
+            approaches.update(stepped.positions(), stepped.time(), approachEvents);
+        });
+    }
+
+    std::cout << "Propagating " << engine.bodyCount() << " bodies for " << options.years - engine.time() << " years ("
+        << (engine.mode() == SimulationMode::NBody ? "N-body" : keplerBackendName()) << ", " << workerCount() << " threads)" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t steps = 0;
+    bool checkpointing = !options.checkpointPath.empty();
+    if (!writer.isOpen() && !checkpointing && !screening && !profiling) {
+        steps = engine.advanceTo(options.years);
+    } else {
+        // Step in stretches between recorded frames (each one timed as a frame when
+        // profiling); the writer thread does all the I/O.
+        // Frames and checkpoints fall on multiples of their intervals, so a resumed run
+        // records the same steps the uninterrupted one would have.
+        uint64_t recordEvery = writer.isOpen() ? options.recordEvery : UNRECORDED_STRETCH_STEPS;
+        uint64_t checkpointInterval = std::max<uint64_t>(1, static_cast<uint64_t>(options.checkpointEvery / engine.timeStep()));
+        uint64_t nextRecord = (engine.stepIndex() / recordEvery + 1) * recordEvery;
+        uint64_t nextCheckpoint = (engine.stepIndex() / checkpointInterval + 1) * checkpointInterval;
+        uint64_t remaining = engine.stepsUntil(options.years);
+        SimulationState state;
+        while (remaining > 0) {
+            uint64_t count = std::min(remaining, nextRecord - engine.stepIndex());
+            if (checkpointing) count = std::min(count, nextCheckpoint - engine.stepIndex());
+            if (screening) count = 1;  // Screening compares consecutive steps
+            int64_t stretchStart = ScopedTimer::now();
+            engine.step(count);
+            recordFrameTime(static_cast<double>(ScopedTimer::now() - stretchStart) * 1e-9);
+            steps += count;
+            remaining -= count;
+            if (engine.stepIndex() == nextRecord) nextRecord += recordEvery;
+            if (checkpointing && engine.stepIndex() == nextCheckpoint) {
+                // Without a trajectory there is no writer thread, so the checkpoint is written inline
+                if (writer.isOpen()) {
+                    writer.requestCheckpoint(engine, options.checkpointPath);
+                } else {
+                    engine.saveState(state);
+                    if (!writeCheckpoint(options.checkpointPath, state, error)) std::cerr << "Checkpoint failed: " << error << std::endl;
+                }
+                nextCheckpoint += checkpointInterval;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double bodySteps = static_cast<double>(steps) * engine.bodyCount();
+    std::cout << steps << " steps in " << seconds << " s ("
+        << (seconds > 0.0 ? bodySteps / seconds : 0.0) << " body-steps/s)" << std::endl;
+
+    if (options.stats && radius.count > 0) {
+        std::cout << "Distance from the Sun: min " << radius.min << ", mean " << radius.sum / static_cast<double>(radius.count)
+            << ", max " << radius.max << std::endl;
+    }
+
+    if (screening) {
+        approaches.flush(approachEvents);
+        std::cout << approachEvents.size() << " close approaches under " << options.approach << std::endl;
+        const size_t shown = 10;
+        for (size_t e = 0; e < approachEvents.size() && e < shown; e++) {
+            const CloseApproachEvent& event = approachEvents[e];
+            std::cout << "  t = " << event.time << ": " << bodyLabel(catalog, event.first) << " and " << bodyLabel(catalog, event.second)
+                << " at " << event.distance << std::endl;
+        }
+    }
+
+    if (writer.isOpen()) {
+        if (!writer.close(error)) {
+            std::cerr << "Trajectory failed: " << error << std::endl;
+            return -1;
+        }
+        std::cout << "Recorded " << writer.framesWritten() << " frames (" << writer.framesDropped() << " dropped, "
+            << writer.bytesWritten() << " bytes)" << std::endl;
+        if (writer.framesDropped() > 0) {
+            std::cerr << "Warning: " << writer.framesDropped() << " frames were dropped; the trajectory has gaps."
+                << " Raise --buffer or drop --lossy to keep every frame" << std::endl;
+        }
+    }
+    if (checkpointing) {
+        // A final checkpoint lets a finished run be extended with a larger --years
+        SimulationState state;
+        engine.saveState(state);
+        if (!writeCheckpoint(options.checkpointPath, state, error)) {
+            std::cerr << "Checkpoint failed: " << error << std::endl;
+            return -1;
+        }
+    }
+
+    if (options.renderStats) {
+        // Build the viewer's batches for the final frame without a GPU
+        SimulationSnapshot snapshot;
+        engine.snapshot(snapshot);
+        DrawListBuilder drawList;
+        drawList.setBodies(catalog);
+        ViewBounds view = makeViewBounds(VIEW_WIDTH_PIXELS, VIEW_HEIGHT_PIXELS, options.zoom, 0.0f, 0.0f);
+        drawList.build(snapshot, view);  // The first build fills the orbit cache, as the viewer's first frame does
+        auto buildStart = std::chrono::steady_clock::now();
+        drawList.build(snapshot, view);
+        double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+        const DrawStats& batched = drawList.stats();
+        DrawStats immediate = immediateModeStats(catalog);
+        std::cout << "Render at zoom " << options.zoom << ": " << batched.drawCalls << " draw calls, " << batched.vertices
+            << " vertices (" << batched.culledBodies << " bodies and " << batched.culledOrbits << " orbits culled), built in "
+            << buildSeconds * 1000.0 << " ms" << std::endl;
+        std::cout << "Immediate mode: " << immediate.drawCalls << " draw calls, " << immediate.vertices << " vertices" << std::endl;
+    }
+
+    if (profiling) {
+        setProfiling(false);
+        printProfile(std::cout);
+        if (!writeChromeTrace(options.profilePath, error)) {
+            std::cerr << "Failed to write trace: " << error << std::endl;
+            return -1;
+        }
+    }
+
+    if (!options.quiet) {
+        SimulationSnapshot snapshot;
+        engine.snapshot(snapshot);
+        std::cout << "t = " << snapshot.time << " years" << std::endl;
+        const size_t shown = 9;
+        // A resumed run takes its bodies from the checkpoint, which may not match the catalog
+        size_t count = std::min({ catalog.size(), snapshot.x.size(), shown });
+        for (size_t i = 0; i < count; i++) {
+            std::cout << "  " << bodyLabel(catalog, i) << ": " << snapshot.x[i] << ", " << snapshot.y[i] << std::endl;
+        }
+    }
+    return 0;
+}
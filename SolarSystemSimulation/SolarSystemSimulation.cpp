@@ -1,131 +1,136 @@
 ﻿// SolarSystemSimulation.cpp : Defines the entry point for the application.
 //
 #include "SolarSystemSimulation.h"
+#include "SimulationEngine.h"
+#include "BodyCatalog.h"
+#include "DrawList.h"
+#include "Ephemeris.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
+#include <memory>
+#include <string>
 #include <vector>
-#include <cstdlib>    // For random number generation
 #include <ctime>      // For seeding the random generator
 
-// Constants for scaling and window size
-const int WINDOW_WIDTH = 1200;
-const int WINDOW_HEIGHT = 800;
-const float SCALE = 1.5f;  // Scaling factor for orbit radii
-const float G = 0.0001f;   // Gravitational constant (scaled for simplicity)
-const float PI = 3.14159f;
-const float TWO_PI = 2 * PI;
-const float TOLERANCE = 1e-6f;  // Tolerance for eccentric anomaly approximation
-const float TIME_SCALE = 0.1f; // Scale factor to slow down orbits
+const double VIEWER_TIME_STEP = 0.001; // Fixed simulation step for the viewer, in simulated years
+const double SCRUB_STEP = 1.0 / 12.0;  // Simulated years per scrub key press (ten times with Shift)
+
+// Every scrubbed frame looks up every body, so the ephemeris only saves work while
+// each body's current segments stay cached. Past this many bodies that cache would
+// take hundreds of megabytes, and each body is solved directly instead.
+const size_t SCRUB_EPHEMERIS_MAX_BODIES = 1 << 16;
+const size_t SCRUB_SEGMENTS_PER_BODY = 2;   // The segment shown and the next one scrubbed into
 
 // Variables for camera control
 float zoomLevel = 1.0f; // Starting zoom level
 float xOffset = 0.0f;   // X-axis pan offset
 float yOffset = 0.0f;   // Y-axis pan offset
 
-// Structure to hold planet data
-struct Planet {
-    float semiMajorAxis; // Semi-major axis of the orbit
-    float eccentricity;  // Eccentricity of the orbit
-    float orbitalPeriod; // Orbital period (speed modifier)
-    float size;          // Visual size of the planet
-    float r, g, b;       // Color of the planet
-    float angle;         // Current angle in orbit (true anomaly)
-    float meanAnomaly;   // Mean anomaly
-    const char* name;    // Name of the planet
-
-    // Constructor to initialize all members
-    Planet(float semiMajorAxis, float eccentricity, float orbitalPeriod, float size, float r, float g, float b, const char* name)
-        : semiMajorAxis(semiMajorAxis), eccentricity(eccentricity), orbitalPeriod(orbitalPeriod), size(size),
-        r(r), g(g), b(b), angle(0.0f), meanAnomaly(0.0f), name(name) {}
-};
-
-// Create planets with semi-major axis, eccentricity, orbital period, size, color, and name
-std::vector<Planet> planets = {
-    Planet(0.4f * SCALE, 0.205f, 0.24f, 0.015f, 1.0f, 0.0f, 0.0f, "Mercury"),
-    Planet(0.7f * SCALE, 0.007f, 0.62f, 0.02f, 1.0f, 1.0f, 1.0f, "Venus"),
-    Planet(1.0f * SCALE, 0.017f, 1.0f, 0.025f, 0.0f, 0.0f, 1.0f, "Earth"),
-    Planet(1.5f * SCALE, 0.093f, 1.88f, 0.02f, 1.0f, 0.0f, 0.0f, "Mars"),
-    Planet(2.8f * SCALE, 0.048f, 11.86f, 0.04f, 1.0f, 0.5f, 0.0f, "Jupiter"),
-    Planet(3.5f * SCALE, 0.056f, 29.45f, 0.035f, 1.0f, 1.0f, 0.5f, "Saturn"),
-    Planet(4.0f * SCALE, 0.046f, 84.02f, 0.03f, 0.0f, 0.5f, 1.0f, "Uranus"),
-    Planet(4.5f * SCALE, 0.010f, 164.79f, 0.03f, 0.0f, 0.0f, 1.0f, "Neptune"),
-    Planet(5.9f * SCALE, 0.249f, 248.0f, 0.02f, 0.8f, 0.8f, 0.8f, "Pluto")  // Adding Pluto with its parameters
-};
-
-// Function to initialize planets with random mean anomaly to avoid straight-line alignment
-void initializePlanets() {
-    srand(static_cast<unsigned int>(time(0))); // Seed the random generator
-
-    for (Planet& planet : planets) {
-        planet.meanAnomaly = static_cast<float>(rand()) / RAND_MAX * TWO_PI; // Randomize mean anomaly
-    }
-}
+// Bodies being shown, the simulation core, and the latest state read back from it for drawing
+BodyCatalog catalog;
+SimulationEngine engine(VIEWER_TIME_STEP);
+SimulationSnapshot frame;
+DrawListBuilder drawList;
+
+// Time scrubbing: while paused, frames come from an ephemeris of the bodies as
+// they were when the run paused, so any date can be shown without stepping to it.
+// scrubEphemeris is left empty for catalogs too large to cache.
+bool paused = false;
+bool scrubMoved = false;    // The shown date changed since the frame was last filled
+double scrubTime = 0.0;
+std::unique_ptr<KeplerEphemerisSource> scrubSource;
+std::unique_ptr<ChebyshevEphemeris> scrubEphemeris;
 
-// Function to draw a circle (Sun or Planet)
-void drawCircle(float x, float y, float radius, float r, float g, float b) {
-    glColor3f(r, g, b);
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2f(x, y);
-    for (int i = 0; i <= 100; i++) {
-        float angle = TWO_PI * i / 100;
-        float dx = cosf(angle) * radius;
-        float dy = sinf(angle) * radius;
-        glVertex2f(x + dx, y + dy);
+// Function to load the bodies to show: the catalog file if one was given, else the
+// built-in planets with random mean anomalies to avoid straight-line alignment
+bool initializePlanets(const char* catalogPath) {
+    if (catalogPath) {
+        std::string error;
+        if (!loadCatalog(catalogPath, catalog, CatalogLoadOptions(), error)) {
+            std::cerr << "Failed to load catalog: " << error << std::endl;
+            return false;
+        }
+    } else {
+        makeDefaultCatalog(catalog, static_cast<unsigned int>(time(0)));
     }
-    glEnd();
+    engine.setElements(catalog.elements);
+    drawList.setBodies(catalog);
+    return true;
 }
 
-// Function to draw the orbit of a planet as an ellipse
-void drawOrbit(const Planet& planet) {
-    glColor3f(0.5f, 0.5f, 0.5f); // Gray color for orbits
-    glBegin(GL_LINE_LOOP);
-    for (int i = 0; i <= 100; i++) {
-        float angle = TWO_PI * i / 100;
-        float radius = planet.semiMajorAxis * (1 - planet.eccentricity * planet.eccentricity) /
-            (1 + planet.eccentricity * cosf(angle));
-        float x = radius * cosf(angle);
-        float y = radius * sinf(angle);
-        glVertex2f(x, y);
+// Function to map a batch primitive to its GL mode
+GLenum glPrimitive(DrawPrimitive primitive) {
+    switch (primitive) {
+    case DrawPrimitive::Points: return GL_POINTS;
+    case DrawPrimitive::Lines: return GL_LINES;
+    default: return GL_TRIANGLES;
     }
-    glEnd();
 }
 
-// Function to update planet positions based on elliptical orbits
-void updatePlanets(float deltaTime) {
-    deltaTime *= TIME_SCALE;
-
-    for (Planet& planet : planets) {
-        // Update mean anomaly based on orbital period
-        planet.meanAnomaly += (TWO_PI / planet.orbitalPeriod) * deltaTime;
-        if (planet.meanAnomaly > TWO_PI) {
-            planet.meanAnomaly -= TWO_PI;
+// Function to submit the frame's batches, one draw call each, from client-side vertex arrays
+void drawBatches(const std::vector<DrawBatch>& batches) {
+    glEnableClientState(GL_VERTEX_ARRAY);
+    for (const DrawBatch& batch : batches) {
+        glVertexPointer(2, GL_FLOAT, 0, batch.vertices);
+        if (batch.colors) {
+            glEnableClientState(GL_COLOR_ARRAY);
+            glColorPointer(3, GL_FLOAT, 0, batch.colors);
+        } else {
+            glDisableClientState(GL_COLOR_ARRAY);
+            glColor3f(batch.r, batch.g, batch.b);
         }
-
-        // Calculate eccentric anomaly using Newton's method with tolerance-based exit
-        float eccentricAnomaly = planet.meanAnomaly;
-        for (int i = 0; i < 10; i++) {
-            float delta = (eccentricAnomaly - planet.eccentricity * sinf(eccentricAnomaly) - planet.meanAnomaly) /
-                (1 - planet.eccentricity * cosf(eccentricAnomaly));
-            eccentricAnomaly -= delta;
-            if (fabs(delta) < TOLERANCE) break;
+        glPointSize(batch.pointSize);
+        if (batch.indices) {
+            glDrawElements(glPrimitive(batch.primitive), static_cast<GLsizei>(batch.count), GL_UNSIGNED_INT, batch.indices);
+        } else {
+            glDrawArrays(glPrimitive(batch.primitive), 0, static_cast<GLsizei>(batch.count));
         }
+    }
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
 
-        // Convert eccentric anomaly to true anomaly
-        float trueAnomaly = 2 * atanf(sqrtf((1 + planet.eccentricity) / (1 - planet.eccentricity)) * tanf(eccentricAnomaly / 2));
-        planet.angle = trueAnomaly;
-
-        // Calculate the radius based on the true anomaly
-        float distance = planet.semiMajorAxis * (1 - planet.eccentricity * planet.eccentricity) /
-            (1 + planet.eccentricity * cosf(trueAnomaly));
+// Function to pause the run and start scrubbing from its current date
+void pauseSimulation() {
+    paused = true;
+    scrubTime = engine.time();
+    scrubMoved = true;
+    scrubSource = std::make_unique<KeplerEphemerisSource>(engine.elements(), engine.time());
+    if (engine.bodyCount() <= SCRUB_EPHEMERIS_MAX_BODIES) {
+        EphemerisSettings settings;
+        settings.cacheCapacity = std::max(settings.cacheCapacity, engine.bodyCount() * SCRUB_SEGMENTS_PER_BODY);
+        scrubEphemeris = std::make_unique<ChebyshevEphemeris>(*scrubSource, settings);
+    }
+}
 
-        // Convert polar coordinates to Cartesian coordinates
-        float x = distance * cosf(planet.angle);
-        float y = distance * sinf(planet.angle);
+// Function to resume the run where it paused; the scrubbed date is only a view
+void resumeSimulation() {
+    paused = false;
+    scrubMoved = true;      // So the frame loop restores the window title
+    scrubEphemeris.reset();
+    scrubSource.reset();
+}
 
-        // Draw the planet
-        drawCircle(x, y, planet.size, planet.r, planet.g, planet.b);
-    }
+// Function to fill the frame with every body's position at the scrubbed date
+void fillScrubFrame() {
+    frame.time = scrubTime;
+    frame.x.resize(engine.bodyCount());
+    frame.y.resize(engine.bodyCount());
+    parallelFor(0, engine.bodyCount(), 4096, [](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            double x, y;
+            if (!scrubEphemeris) scrubSource->sample(i, scrubTime, x, y);
+            else if (!scrubEphemeris->position(i, scrubTime, x, y)) continue;
+            frame.x[i] = static_cast<float>(x);
+            frame.y[i] = static_cast<float>(y);
+        }
+    });
+    scrubMoved = false;
 }
 
 // Handle scroll input for zooming
@@ -142,17 +147,39 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
         if (key == GLFW_KEY_RIGHT) xOffset += panSpeed;
         if (key == GLFW_KEY_UP) yOffset += panSpeed;
         if (key == GLFW_KEY_DOWN) yOffset -= panSpeed;
+
+        // Space pauses and resumes; [ and ] scrub the shown date, pausing first if needed
+        if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+            if (paused) resumeSimulation();
+            else pauseSimulation();
+        }
+        if (key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET) {
+            if (!paused) pauseSimulation();
+            double step = (mods & GLFW_MOD_SHIFT) ? 10.0 * SCRUB_STEP : SCRUB_STEP;
+            scrubTime += key == GLFW_KEY_LEFT_BRACKET ? -step : step;
+            scrubMoved = true;
+        }
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // An optional catalog file replaces the built-in planets; --trace <file> profiles the session
+    const char* catalogPath = nullptr;
+    const char* tracePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) tracePath = argv[++i];
+        else catalogPath = argv[i];
+    }
+    setProfiling(tracePath != nullptr);
+    if (!initializePlanets(catalogPath)) return -1;
+
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
     }
 
     // Create a 4K window instead of fullscreen, positioned at the top-left corner
-    GLFWwindow* window = glfwCreateWindow(3840, 2160, "Solar System Simulation", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(VIEW_WIDTH_PIXELS, VIEW_HEIGHT_PIXELS, "Solar System Simulation", NULL, NULL);
     if (!window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -168,20 +195,35 @@ int main() {
     // Set up orthographic projection as before, adjusting as needed for scale and zoom
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    const float FULL_SCALE = 10.0f;  // You may adjust this for the larger view area
-    float aspectRatio = 3840.0f / 2160.0f;
-    glOrtho(-FULL_SCALE * aspectRatio, FULL_SCALE * aspectRatio, -FULL_SCALE, FULL_SCALE, -1.0, 1.0);
+    float aspectRatio = static_cast<float>(VIEW_WIDTH_PIXELS) / VIEW_HEIGHT_PIXELS;
+    glOrtho(-VIEW_HALF_HEIGHT * aspectRatio, VIEW_HALF_HEIGHT * aspectRatio, -VIEW_HALF_HEIGHT, VIEW_HALF_HEIGHT, -1.0, 1.0);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
 
-    initializePlanets();
-
-    float previousTime = glfwGetTime();
+    double previousTime = glfwGetTime();
+    double simulationTime = 0.0;
 
     while (!glfwWindowShouldClose(window)) {
-        float currentTime = glfwGetTime();
-        float deltaTime = currentTime - previousTime;
+        double currentTime = glfwGetTime();
+        double deltaTime = currentTime - previousTime;
         previousTime = currentTime;
+        recordFrameTime(deltaTime);
+        ScopedTimer frameTimer("frame");
+
+        // Physics runs in fixed steps; the frame delta only decides how many to take
+        if (!paused) {
+            simulationTime += deltaTime * TIME_SCALE;
+            engine.advanceTo(simulationTime);
+            engine.snapshot(frame);
+        } else if (scrubMoved) {
+            fillScrubFrame();
+            std::string title = "Solar System Simulation - t = " + std::to_string(scrubTime) + " years (paused)";
+            glfwSetWindowTitle(window, title.c_str());
+        }
+        if (!paused && scrubMoved) {
+            glfwSetWindowTitle(window, "Solar System Simulation");
+            scrubMoved = false;
+        }
 
         glClear(GL_COLOR_BUFFER_BIT);
         glPushMatrix();
@@ -190,10 +232,12 @@ int main() {
         glScalef(zoomLevel, zoomLevel, 1.0f);
         glTranslatef(xOffset, yOffset, 0.0f);
 
-        // Draw the Sun and planetary orbits
-        drawCircle(0.0f, 0.0f, 0.1f, 1.0f, 1.0f, 0.0f);
-        for (const Planet& planet : planets) drawOrbit(planet);
-        updatePlanets(deltaTime);
+        // Draw the Sun, orbits and bodies that fall inside the current view
+        drawList.build(frame, makeViewBounds(VIEW_WIDTH_PIXELS, VIEW_HEIGHT_PIXELS, zoomLevel, xOffset, yOffset));
+        {
+            ScopedTimer drawTimer("submit batches");
+            drawBatches(drawList.batches());
+        }
 
         glPopMatrix();
         glfwSwapBuffers(window);
@@ -202,5 +246,12 @@ int main() {
 
     glfwDestroyWindow(window);
     glfwTerminate();
+
+    if (tracePath) {
+        setProfiling(false);
+        printProfile(std::cout);
+        std::string error;
+        if (!writeChromeTrace(tracePath, error)) std::cerr << "Failed to write trace: " << error << std::endl;
+    }
     return 0;
 }
@@ -5,4 +5,8 @@
 
 #include <iostream>
 
-// TODO: Reference additional headers your program requires here.
+// Constants shared by the simulation core and the viewer
+const float SCALE = 1.5f;  // Scaling factor for orbit radii
+const float PI = 3.14159f;
+const float TWO_PI = 2 * PI;
+const float TIME_SCALE = 0.1f; // Scale factor to slow down orbits
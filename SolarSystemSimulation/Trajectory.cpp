@@ -0,0 +1,765 @@
+// Trajectory.cpp : Trajectory file format, the background writer, the mapped
+// reader and checkpoint files.
+//
+#include "Trajectory.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+const char FILE_MAGIC[4] = { 'S', 'S', 'T', 'R' };
+const char CHUNK_MAGIC[4] = { 'S', 'S', 'C', 'K' };
+const char INDEX_MAGIC[4] = { 'S', 'S', 'I', 'X' };
+const uint32_t FILE_VERSION = 1;
+const size_t FILE_ALIGNMENT = 64;
+
+// What a file holds after its header
+const uint32_t KIND_TRAJECTORY = 0;
+const uint32_t KIND_CHECKPOINT = 1;
+
+// Checkpoint sections after the element arrays: N-body x, y, vx, vy, mu
+const int NBODY_ARRAY_COUNT = 5;
+
+// How long the writer thread sleeps before re-checking the ring buffer, in case
+// a wakeup raced with it going to sleep
+const std::chrono::milliseconds WRITER_POLL(2);
+
+// Structure to hold the fixed header at the start of trajectory and checkpoint files
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t encoding;          // TrajectoryEncoding; trajectories only
+    uint64_t bodyCount;
+    double timeStep;
+    double quantization;        // Trajectories only
+    uint64_t step;              // Checkpoints only, from here down
+    uint32_t mode;
+    uint32_t method;
+    uint32_t scheme;
+    uint32_t reserved;
+    double openingAngle;
+    double softening;
+    uint64_t nbodyCount;
+};
+
+// Structure to hold the header of one trajectory chunk. The frame table follows
+// it; position data starts at dataOffset from the chunk header.
+struct ChunkHeader {
+    char magic[4];
+    uint32_t frameCount;
+    uint64_t firstStep, lastStep;
+    double firstTime, lastTime;
+    uint64_t dataOffset;
+    uint64_t dataBytes;
+};
+
+// Structure to hold one frame table entry
+struct FrameEntry {
+    uint64_t step;
+    double time;
+    uint64_t offset;    // Start of the frame's data, relative to the chunk's data
+};
+
+// Structure to hold the footer at the very end of a closed trajectory file
+struct IndexFooter {
+    uint64_t indexOffset;
+    uint64_t chunkCount;
+    uint64_t frameCount;
+    char magic[4];
+    uint32_t version;
+};
+
+// Function to round offset up to the file alignment
+inline size_t alignUp(size_t offset) {
+    return (offset + FILE_ALIGNMENT - 1) / FILE_ALIGNMENT * FILE_ALIGNMENT;
+}
+
+// Function to write zero bytes up to the next aligned offset
+void writePadding(std::ofstream& out, size_t written) {
+    const char padding[FILE_ALIGNMENT] = {};
+    out.write(padding, static_cast<std::streamsize>(alignUp(written) - written));
+}
+
+// Function to append a signed value as a zigzag varint, returning the new end
+inline char* putVarint(char* out, int64_t value) {
+    uint64_t bits = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    while (bits >= 0x80) {
+        *out++ = static_cast<char>(bits | 0x80);
+        bits >>= 7;
+    }
+    *out++ = static_cast<char>(bits);
+    return out;
+}
+
+// Function to read a zigzag varint; returns false if it runs past end
+inline bool getVarint(const char*& in, const char* end, int64_t& value) {
+    uint64_t bits = 0;
+    for (int shift = 0; shift < 64 && in < end; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*in++);
+        bits |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            value = static_cast<int64_t>(bits >> 1) ^ -static_cast<int64_t>(bits & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to predict the next quantized value from the previous two in the chunk
+inline int64_t predict(uint64_t frameInChunk, int64_t previous, int64_t beforePrevious) {
+    if (frameInChunk == 0) return 0;
+    if (frameInChunk == 1) return previous;
+    return 2 * previous - beforePrevious;
+}
+
+// Function to compute where every section of a checkpoint starts; returns the file size
+size_t checkpointLayout(size_t bodyCount, size_t nbodyCount, size_t offsets[ELEMENT_ARRAY_COUNT + NBODY_ARRAY_COUNT]) {
+    size_t cursor = alignUp(sizeof(FileHeader));
+    for (int s = 0; s < ELEMENT_ARRAY_COUNT; s++) {
+        offsets[s] = cursor;
+        cursor = alignUp(cursor + bodyCount * sizeof(float));
+    }
+    for (int s = 0; s < NBODY_ARRAY_COUNT; s++) {
+        offsets[ELEMENT_ARRAY_COUNT + s] = cursor;
+        cursor = alignUp(cursor + nbodyCount * sizeof(double));
+    }
+    return cursor;
+}
+
+// Function to read and check the header shared by both file kinds
+bool readHeader(const MappedFile& file, uint32_t kind, const std::string& path, FileHeader& header, std::string& error) {
+    if (file.size() < alignUp(sizeof(FileHeader))) {
+        error = path + " is too small to be a trajectory or checkpoint";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION) {
+        error = path + " is not a version " + std::to_string(FILE_VERSION) + " trajectory file";
+        return false;
+    }
+    if (header.kind != kind) {
+        error = path + (kind == KIND_CHECKPOINT ? " is not a checkpoint" : " is not a trajectory");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+TrajectoryWriter::~TrajectoryWriter() {
+    std::string ignored;
+    close(ignored);
+}
+
+bool TrajectoryWriter::open(const std::string& path, size_t bodyCount, double timeStep, const TrajectorySettings& settings,
+    std::string& error) {
+    if (isOpen()) close(error);
+
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        error = "cannot create " + path;
+        return false;
+    }
+    path_ = path;
+    bodyCount_ = bodyCount;
+    settings_ = settings;
+    settings_.framesPerChunk = std::max<size_t>(settings_.framesPerChunk, 1);
+
+    FileHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.kind = KIND_TRAJECTORY;
+    header.encoding = static_cast<uint32_t>(settings_.encoding);
+    header.bodyCount = bodyCount;
+    header.timeStep = timeStep;
+    header.quantization = settings_.quantization;
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writePadding(file_, sizeof(header));
+    if (!file_) {
+        error = "failed writing " + path;
+        file_.close();
+        return false;
+    }
+    fileSize_ = alignUp(sizeof(header));
+    index_.clear();
+    chunk_ = {};
+    previous_.assign(2 * bodyCount_, 0);
+    beforePrevious_.assign(2 * bodyCount_, 0);
+    framesWritten_ = 0;
+    start();
+    return true;
+}
+
+bool TrajectoryWriter::openForResume(const std::string& path, uint64_t resumeStep, const TrajectorySettings& settings,
+    std::string& error) {
+    if (isOpen()) close(error);
+
+    // Keep every frame up to resumeStep. Whole chunks stay on disk untouched; the
+    // frames of a chunk cut in two are decoded and queued to be written again.
+    TrajectorySettings resumed = settings;
+    uint64_t keepBytes;
+    size_t bodyCount;
+    std::vector<SimulationSnapshot> carried;
+    index_.clear();
+    {
+        TrajectoryReader reader;
+        if (!reader.open(path, error)) return false;
+        bodyCount = reader.bodyCount();
+        resumed.encoding = reader.encoding();
+        resumed.quantization = reader.quantization_;
+        keepBytes = alignUp(sizeof(FileHeader));
+        for (const TrajectoryReader::Chunk& chunk : reader.chunks_) {
+            if (chunk.info.lastStep <= resumeStep) {
+                index_.push_back(chunk.info);
+                keepBytes = chunk.end;
+                continue;
+            }
+            for (uint64_t f = 0; f < chunk.info.frameCount; f++) {
+                uint64_t frame = chunk.firstFrame + f;
+                if (reader.frameStep(frame) > resumeStep) break;
+                carried.emplace_back();
+                if (!reader.readFrame(frame, carried.back())) {
+                    error = path + " has a corrupt chunk";
+                    return false;
+                }
+            }
+            break;
+        }
+    }
+
+    std::error_code code;
+    std::filesystem::resize_file(path, keepBytes, code);
+    if (code) {
+        error = "cannot truncate " + path + ": " + code.message();
+        return false;
+    }
+    file_.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    file_.seekp(static_cast<std::streamoff>(keepBytes));
+    if (!file_) {
+        error = "cannot reopen " + path;
+        return false;
+    }
+    path_ = path;
+    bodyCount_ = bodyCount;
+    settings_ = resumed;
+    settings_.framesPerChunk = std::max<size_t>(settings_.framesPerChunk, 1);
+    fileSize_ = keepBytes;
+    chunk_ = {};
+    previous_.assign(2 * bodyCount_, 0);
+    beforePrevious_.assign(2 * bodyCount_, 0);
+    framesWritten_ = 0;
+    for (const SimulationSnapshot& frame : carried) encodeFrame(frame);
+    start();
+    return true;
+}
+
+void TrajectoryWriter::start() {
+    // Which frames survive a drop depends on thread timing, so a deterministic run never drops
+    if (deterministicScheduling()) settings_.blocking = true;
+    slots_.assign(std::max<size_t>(settings_.bufferFrames, 2), SimulationSnapshot());
+    head_ = 0;
+    tail_ = 0;
+    stopping_ = false;
+    checkpointPending_ = false;
+    framesDropped_ = 0;
+    checkpointsWritten_ = 0;
+    bytesWritten_ = fileSize_;
+    failed_ = false;
+    error_.clear();
+    thread_ = std::thread(&TrajectoryWriter::run, this);
+}
+
+bool TrajectoryWriter::record(const SimulationEngine& engine) {
+    if (!isOpen()) return false;
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= slots_.size()) {
+        if (!settings_.blocking) {
+            framesDropped_++;
+            return false;
+        }
+        // The writer may be asleep between polls, so wake it before waiting on it
+        wake_.notify_one();
+        std::unique_lock<std::mutex> lock(spaceMutex_);
+        while (head - tail_.load(std::memory_order_acquire) >= slots_.size()) space_.wait_for(lock, WRITER_POLL);
+    }
+    engine.snapshot(slots_[head % slots_.size()]);
+    head_.store(head + 1, std::memory_order_release);
+    wake_.notify_one();
+    return true;
+}
+
+bool TrajectoryWriter::requestCheckpoint(const SimulationEngine& engine, const std::string& path) {
+    if (!isOpen() || checkpointPending_.load(std::memory_order_acquire)) return false;
+    engine.saveState(checkpointState_);
+    checkpointPath_ = path;
+    checkpointHead_ = head_.load(std::memory_order_relaxed);
+    checkpointPending_.store(true, std::memory_order_release);
+    wake_.notify_one();
+    return true;
+}
+
+bool TrajectoryWriter::close(std::string& error) {
+    if (!isOpen()) return true;
+    stopping_.store(true, std::memory_order_release);
+    wake_.notify_one();
+    thread_.join();
+    file_.close();
+    if (failed_) {
+        error = error_;
+        return false;
+    }
+    return true;
+}
+
+void TrajectoryWriter::fail(const std::string& message) {
+    if (!failed_) {
+        error_ = message;
+        failed_ = true;
+    }
+}
+
+void TrajectoryWriter::run() {
+    while (true) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (checkpointPending_.load(std::memory_order_acquire) && tail >= checkpointHead_) {
+            // Everything recorded before the checkpoint reaches the disk first, so a
+            // resumed run never has a gap in its trajectory
+            if (!failed_ && flushChunk()) {
+                file_.flush();
+                writeCheckpointNow();
+            }
+            checkpointPending_.store(false, std::memory_order_release);
+            continue;
+        }
+        if (tail < head_.load(std::memory_order_acquire)) {
+            if (!failed_) encodeFrame(slots_[tail % slots_.size()]);
+            tail_.store(tail + 1, std::memory_order_release);
+            space_.notify_one();
+            continue;
+        }
+        if (stopping_.load(std::memory_order_acquire)) {
+            if (tail == head_.load(std::memory_order_acquire)) break;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wake_.wait_for(lock, WRITER_POLL);
+    }
+
+    // Write the index of every chunk so readers can find frames without scanning
+    if (failed_ || !flushChunk()) return;
+    IndexFooter footer = {};
+    footer.indexOffset = fileSize_;
+    footer.chunkCount = index_.size();
+    for (const TrajectoryChunk& chunk : index_) footer.frameCount += chunk.frameCount;
+    std::memcpy(footer.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    footer.version = FILE_VERSION;
+    file_.write(reinterpret_cast<const char*>(index_.data()), static_cast<std::streamsize>(index_.size() * sizeof(TrajectoryChunk)));
+    file_.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    file_.flush();
+    if (!file_) {
+        fail("failed writing the index of " + path_);
+        return;
+    }
+    fileSize_ += index_.size() * sizeof(TrajectoryChunk) + sizeof(footer);
+    bytesWritten_ = fileSize_;
+}
+
+void TrajectoryWriter::encodeFrame(const SimulationSnapshot& frame) {
+    ScopedTimer timer("encode frame");
+    if (frame.x.size() != bodyCount_) {
+        fail("body count changed while recording " + path_);
+        return;
+    }
+    if (chunk_.frameCount == 0) {
+        chunk_.firstStep = frame.step;
+        chunk_.firstTime = frame.time;
+    }
+    FrameEntry entry = { frame.step, frame.time, chunkData_.size() };
+    const char* entryBytes = reinterpret_cast<const char*>(&entry);
+    chunkFrames_.insert(chunkFrames_.end(), entryBytes, entryBytes + sizeof(entry));
+
+    if (settings_.encoding == TrajectoryEncoding::Raw) {
+        const char* x = reinterpret_cast<const char*>(frame.x.data());
+        const char* y = reinterpret_cast<const char*>(frame.y.data());
+        chunkData_.insert(chunkData_.end(), x, x + bodyCount_ * sizeof(float));
+        chunkData_.insert(chunkData_.end(), y, y + bodyCount_ * sizeof(float));
+    } else {
+        // Reserve the worst case (10 bytes per value), encode, then trim
+        const double inverse = 1.0 / settings_.quantization;
+        size_t start = chunkData_.size();
+        chunkData_.resize(start + 2 * bodyCount_ * 10);
+        char* out = chunkData_.data() + start;
+        const float* axes[2] = { frame.x.data(), frame.y.data() };
+        for (size_t axis = 0; axis < 2; axis++) {
+            int64_t* previous = &previous_[axis * bodyCount_];
+            int64_t* beforePrevious = &beforePrevious_[axis * bodyCount_];
+            for (size_t i = 0; i < bodyCount_; i++) {
+                int64_t value = std::llround(static_cast<double>(axes[axis][i]) * inverse);
+                out = putVarint(out, value - predict(chunk_.frameCount, previous[i], beforePrevious[i]));
+                beforePrevious[i] = previous[i];
+                previous[i] = value;
+            }
+        }
+        chunkData_.resize(static_cast<size_t>(out - chunkData_.data()));
+    }
+
+    chunk_.lastStep = frame.step;
+    chunk_.lastTime = frame.time;
+    chunk_.frameCount++;
+    if (chunk_.frameCount >= settings_.framesPerChunk || chunkData_.size() >= settings_.maxChunkBytes) flushChunk();
+}
+
+bool TrajectoryWriter::flushChunk() {
+    if (chunk_.frameCount == 0) return true;
+
+    ChunkHeader header = {};
+    std::memcpy(header.magic, CHUNK_MAGIC, sizeof(CHUNK_MAGIC));
+    header.frameCount = static_cast<uint32_t>(chunk_.frameCount);
+    header.firstStep = chunk_.firstStep;
+    header.lastStep = chunk_.lastStep;
+    header.firstTime = chunk_.firstTime;
+    header.lastTime = chunk_.lastTime;
+    header.dataOffset = alignUp(sizeof(header) + chunkFrames_.size());
+    header.dataBytes = chunkData_.size();
+
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_.write(chunkFrames_.data(), static_cast<std::streamsize>(chunkFrames_.size()));
+    writePadding(file_, sizeof(header) + chunkFrames_.size());
+    file_.write(chunkData_.data(), static_cast<std::streamsize>(chunkData_.size()));
+    writePadding(file_, static_cast<size_t>(header.dataOffset + header.dataBytes));
+    if (!file_) {
+        fail("failed writing " + path_);
+        return false;
+    }
+
+    chunk_.offset = fileSize_;
+    index_.push_back(chunk_);
+    fileSize_ += alignUp(static_cast<size_t>(header.dataOffset + header.dataBytes));
+    bytesWritten_ = fileSize_;
+    framesWritten_ += chunk_.frameCount;
+    chunk_ = {};
+    chunkFrames_.clear();
+    chunkData_.clear();
+    return true;
+}
+
+bool TrajectoryWriter::writeCheckpointNow() {
+    std::string error;
+    if (!writeCheckpoint(checkpointPath_, checkpointState_, error)) {
+        fail(error);
+        return false;
+    }
+    checkpointsWritten_++;
+    return true;
+}
+
+bool TrajectoryReader::open(const std::string& path, std::string& error) {
+    chunks_.clear();
+    frameCount_ = 0;
+    recovered_ = false;
+    cursorChunk_ = SIZE_MAX;
+    if (!file_.open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    FileHeader header;
+    if (!readHeader(file_, KIND_TRAJECTORY, path, header, error)) return false;
+    // Bound the body count by the file size before anything is sized from it
+    if (header.bodyCount > file_.size() / sizeof(float)) {
+        error = path + " is truncated";
+        return false;
+    }
+    if (header.encoding > static_cast<uint32_t>(TrajectoryEncoding::DeltaQuantized)) {
+        error = path + " has an unknown encoding";
+        return false;
+    }
+    bodyCount_ = static_cast<size_t>(header.bodyCount);
+    timeStep_ = header.timeStep;
+    quantization_ = header.quantization;
+    encoding_ = static_cast<TrajectoryEncoding>(header.encoding);
+    previous_.assign(2 * bodyCount_, 0);
+    beforePrevious_.assign(2 * bodyCount_, 0);
+
+    const char* data = file_.data();
+    size_t size = file_.size();
+
+    // Function to add the chunk at offset; returns false if it is missing or cut short.
+    // Every field is checked against what is left of the file before it is added to anything.
+    auto addChunk = [&](uint64_t offset) {
+        ChunkHeader chunkHeader;
+        if (offset > size || sizeof(chunkHeader) > size - offset) return false;
+        std::memcpy(&chunkHeader, data + offset, sizeof(chunkHeader));
+        if (std::memcmp(chunkHeader.magic, CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) != 0) return false;
+        uint64_t available = size - offset;
+        if (chunkHeader.dataOffset < sizeof(chunkHeader) || chunkHeader.dataOffset > available ||
+            chunkHeader.dataBytes > available - chunkHeader.dataOffset) return false;
+        if (chunkHeader.frameCount > (chunkHeader.dataOffset - sizeof(chunkHeader)) / sizeof(FrameEntry)) return false;
+        uint64_t end = offset + alignUp(static_cast<size_t>(chunkHeader.dataOffset + chunkHeader.dataBytes));
+        if (end > size) return false;
+
+        Chunk chunk;
+        chunk.info = { offset, chunkHeader.firstStep, chunkHeader.lastStep, chunkHeader.firstTime, chunkHeader.lastTime,
+            chunkHeader.frameCount };
+        chunk.firstFrame = frameCount_;
+        chunk.end = end;
+        chunk.frames = data + offset + sizeof(chunkHeader);
+        chunk.data = data + offset + chunkHeader.dataOffset;
+        chunk.dataEnd = chunk.data + chunkHeader.dataBytes;
+        chunks_.push_back(chunk);
+        frameCount_ += chunkHeader.frameCount;
+        return true;
+    };
+
+    // A closed file ends with the index; otherwise walk the chunks that made it to disk
+    IndexFooter footer;
+    bool indexed = false;
+    if (size >= alignUp(sizeof(FileHeader)) + sizeof(footer)) {
+        std::memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+        uint64_t indexSpace = size - sizeof(footer);
+        indexed = std::memcmp(footer.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+            footer.chunkCount <= indexSpace / sizeof(TrajectoryChunk) &&
+            footer.indexOffset == indexSpace - footer.chunkCount * sizeof(TrajectoryChunk);
+    }
+    if (indexed) {
+        for (uint64_t c = 0; c < footer.chunkCount; c++) {
+            TrajectoryChunk entry;
+            std::memcpy(&entry, data + footer.indexOffset + c * sizeof(entry), sizeof(entry));
+            if (!addChunk(entry.offset)) {
+                error = path + " has a corrupt chunk index";
+                return false;
+            }
+        }
+    } else {
+        uint64_t offset = alignUp(sizeof(FileHeader));
+        while (addChunk(offset)) offset = chunks_.back().end;
+        recovered_ = true;
+    }
+    return true;
+}
+
+size_t TrajectoryReader::chunkOf(uint64_t frame) const {
+    auto found = std::upper_bound(chunks_.begin(), chunks_.end(), frame,
+        [](uint64_t value, const Chunk& chunk) { return value < chunk.firstFrame; });
+    return static_cast<size_t>(found - chunks_.begin()) - 1;
+}
+
+bool TrajectoryReader::frameFits(const Chunk& chunk, uint64_t offset, size_t bytes) {
+    uint64_t dataBytes = static_cast<uint64_t>(chunk.dataEnd - chunk.data);
+    return offset <= dataBytes && bytes <= dataBytes - offset;
+}
+
+uint64_t TrajectoryReader::frameStep(uint64_t frame) const {
+    const Chunk& chunk = chunks_[chunkOf(frame)];
+    FrameEntry entry;
+    std::memcpy(&entry, chunk.frames + (frame - chunk.firstFrame) * sizeof(entry), sizeof(entry));
+    return entry.step;
+}
+
+double TrajectoryReader::frameTime(uint64_t frame) const {
+    const Chunk& chunk = chunks_[chunkOf(frame)];
+    FrameEntry entry;
+    std::memcpy(&entry, chunk.frames + (frame - chunk.firstFrame) * sizeof(entry), sizeof(entry));
+    return entry.time;
+}
+
+bool TrajectoryReader::findFrame(double time, uint64_t& frame) const {
+    // Narrow down with the chunk index, then binary search the chunk's frame table
+    auto found = std::upper_bound(chunks_.begin(), chunks_.end(), time,
+        [](double value, const Chunk& chunk) { return value < chunk.info.firstTime; });
+    if (found == chunks_.begin()) return false;
+    const Chunk& chunk = *(found - 1);
+    uint64_t low = 0, high = chunk.info.frameCount;
+    while (high - low > 1) {
+        uint64_t middle = (low + high) / 2;
+        if (frameTime(chunk.firstFrame + middle) <= time) low = middle;
+        else high = middle;
+    }
+    frame = chunk.firstFrame + low;
+    return true;
+}
+
+bool TrajectoryReader::rawFrame(uint64_t frame, const float*& x, const float*& y) const {
+    if (encoding_ != TrajectoryEncoding::Raw || frame >= frameCount_) return false;
+    const Chunk& chunk = chunks_[chunkOf(frame)];
+    FrameEntry entry;
+    std::memcpy(&entry, chunk.frames + (frame - chunk.firstFrame) * sizeof(entry), sizeof(entry));
+    if (!frameFits(chunk, entry.offset, 2 * bodyCount_ * sizeof(float))) return false;
+    x = reinterpret_cast<const float*>(chunk.data + entry.offset);
+    y = x + bodyCount_;
+    return true;
+}
+
+bool TrajectoryReader::decodeFrame(const Chunk& chunk, uint64_t local, bool output, SimulationSnapshot& out) {
+    FrameEntry entry;
+    std::memcpy(&entry, chunk.frames + local * sizeof(entry), sizeof(entry));
+    if (!frameFits(chunk, entry.offset, 0)) return false;
+    const char* in = chunk.data + entry.offset;
+    float* axes[2] = { out.x.data(), out.y.data() };
+    for (size_t axis = 0; axis < 2; axis++) {
+        int64_t* previous = &previous_[axis * bodyCount_];
+        int64_t* beforePrevious = &beforePrevious_[axis * bodyCount_];
+        for (size_t i = 0; i < bodyCount_; i++) {
+            int64_t residual;
+            if (!getVarint(in, chunk.dataEnd, residual)) return false;
+            int64_t value = predict(local, previous[i], beforePrevious[i]) + residual;
+            beforePrevious[i] = previous[i];
+            previous[i] = value;
+            if (output) axes[axis][i] = static_cast<float>(static_cast<double>(value) * quantization_);
+        }
+    }
+    return true;
+}
+
+bool TrajectoryReader::readFrame(uint64_t frame, SimulationSnapshot& out) {
+    if (frame >= frameCount_) return false;
+    size_t c = chunkOf(frame);
+    const Chunk& chunk = chunks_[c];
+    uint64_t local = frame - chunk.firstFrame;
+    FrameEntry entry;
+    std::memcpy(&entry, chunk.frames + local * sizeof(entry), sizeof(entry));
+    out.step = entry.step;
+    out.time = entry.time;
+    out.x.resize(bodyCount_);
+    out.y.resize(bodyCount_);
+
+    if (encoding_ == TrajectoryEncoding::Raw) {
+        if (!frameFits(chunk, entry.offset, 2 * bodyCount_ * sizeof(float))) return false;
+        std::memcpy(out.x.data(), chunk.data + entry.offset, bodyCount_ * sizeof(float));
+        std::memcpy(out.y.data(), chunk.data + entry.offset + bodyCount_ * sizeof(float), bodyCount_ * sizeof(float));
+        return true;
+    }
+
+    // Each frame is predicted from the two before it, so decode forward from the
+    // cursor, or from the start of the chunk when seeking backwards or elsewhere
+    if (cursorChunk_ != c || cursorFrame_ > local) {
+        cursorChunk_ = c;
+        cursorFrame_ = 0;
+    }
+    while (cursorFrame_ <= local) {
+        if (!decodeFrame(chunk, cursorFrame_, cursorFrame_ == local, out)) {
+            cursorChunk_ = SIZE_MAX;
+            return false;
+        }
+        cursorFrame_++;
+    }
+    return true;
+}
+
+bool writeCheckpoint(const std::string& path, const SimulationState& state, std::string& error) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            error = "cannot create " + temporary;
+            return false;
+        }
+
+        size_t bodyCount = state.elements.size();
+        size_t nbodyCount = state.mode == SimulationMode::NBody ? state.nbody.size() : 0;
+        FileHeader header = {};
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header.version = FILE_VERSION;
+        header.kind = KIND_CHECKPOINT;
+        header.bodyCount = bodyCount;
+        header.timeStep = state.timeStep;
+        header.step = state.step;
+        header.mode = static_cast<uint32_t>(state.mode);
+        header.method = static_cast<uint32_t>(state.nbodySettings.method);
+        header.scheme = static_cast<uint32_t>(state.nbodySettings.scheme);
+        header.openingAngle = state.nbodySettings.openingAngle;
+        header.softening = state.nbodySettings.softening;
+        header.nbodyCount = nbodyCount;
+
+        const float* elementArrays[ELEMENT_ARRAY_COUNT];
+        state.elements.arrays(elementArrays);
+        const double* nbodyArrays[NBODY_ARRAY_COUNT] = { state.nbody.x.data(), state.nbody.y.data(), state.nbody.vx.data(),
+            state.nbody.vy.data(), state.nbody.mu.data() };
+
+        // Sections are in the same aligned layout readCheckpoint expects
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writePadding(out, sizeof(header));
+        for (const float* array : elementArrays) {
+            out.write(reinterpret_cast<const char*>(array), static_cast<std::streamsize>(bodyCount * sizeof(float)));
+            writePadding(out, bodyCount * sizeof(float));
+        }
+        for (const double* array : nbodyArrays) {
+            out.write(reinterpret_cast<const char*>(array), static_cast<std::streamsize>(nbodyCount * sizeof(double)));
+            writePadding(out, nbodyCount * sizeof(double));
+        }
+        out.flush();
+        if (!out) {
+            error = "failed writing " + temporary;
+            return false;
+        }
+    }
+
+    std::error_code code;
+    std::filesystem::rename(temporary, path, code);
+    if (code) {
+        error = "cannot replace " + path + ": " + code.message();
+        return false;
+    }
+    return true;
+}
+
+bool readCheckpoint(const std::string& path, SimulationState& state, std::string& error) {
+    MappedFile file;
+    if (!file.open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    FileHeader header;
+    if (!readHeader(file, KIND_CHECKPOINT, path, header, error)) return false;
+
+    // Bound the header's counts by the file size first, so the layout sums below cannot overflow
+    if (header.bodyCount > file.size() / sizeof(float) || header.nbodyCount > file.size() / sizeof(double)) {
+        error = path + " is truncated";
+        return false;
+    }
+    size_t bodyCount = static_cast<size_t>(header.bodyCount);
+    size_t nbodyCount = static_cast<size_t>(header.nbodyCount);
+    size_t offsets[ELEMENT_ARRAY_COUNT + NBODY_ARRAY_COUNT];
+    if (checkpointLayout(bodyCount, nbodyCount, offsets) > file.size()) {
+        error = path + " is truncated";
+        return false;
+    }
+    if (header.mode > static_cast<uint32_t>(SimulationMode::NBody) ||
+        header.method > static_cast<uint32_t>(ForceMethod::BarnesHut) ||
+        header.scheme > static_cast<uint32_t>(IntegratorScheme::WisdomHolman)) {
+        error = path + " has an unknown simulation mode, force method or integrator";
+        return false;
+    }
+    // N-body state covers every body; the engine would only notice a mismatch mid-run
+    if (header.mode == static_cast<uint32_t>(SimulationMode::NBody) && nbodyCount != bodyCount) {
+        error = path + " has " + std::to_string(nbodyCount) + " N-body states for " + std::to_string(bodyCount) + " bodies";
+        return false;
+    }
+
+    state.mode = static_cast<SimulationMode>(header.mode);
+    state.timeStep = header.timeStep;
+    state.step = header.step;
+    state.nbodySettings.method = static_cast<ForceMethod>(header.method);
+    state.nbodySettings.scheme = static_cast<IntegratorScheme>(header.scheme);
+    state.nbodySettings.openingAngle = header.openingAngle;
+    state.nbodySettings.softening = header.softening;
+
+    state.elements.resize(bodyCount);
+    float* elementArrays[ELEMENT_ARRAY_COUNT];
+    state.elements.arrays(elementArrays);
+    for (int s = 0; s < ELEMENT_ARRAY_COUNT && bodyCount > 0; s++) {
+        std::memcpy(elementArrays[s], file.data() + offsets[s], bodyCount * sizeof(float));
+    }
+    state.nbody.resize(nbodyCount);
+    double* nbodyArrays[NBODY_ARRAY_COUNT] = { state.nbody.x.data(), state.nbody.y.data(), state.nbody.vx.data(),
+        state.nbody.vy.data(), state.nbody.mu.data() };
+    for (int s = 0; s < NBODY_ARRAY_COUNT && nbodyCount > 0; s++) {
+        std::memcpy(nbodyArrays[s], file.data() + offsets[ELEMENT_ARRAY_COUNT + s], nbodyCount * sizeof(double));
+    }
+    return true;
+}
@@ -0,0 +1,197 @@
+// Trajectory.h : Streaming trajectory recording and checkpoint / restart. A
+// background thread drains a ring buffer of snapshots into a chunked file with
+// a time index; checkpoints use the same container to store the full state.
+
+#pragma once
+
+#include "MappedFile.h"
+#include "SimulationEngine.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// How positions are stored inside a trajectory chunk
+enum class TrajectoryEncoding {
+    Raw,            // float32 x and y arrays per frame; readable in place from a mapping
+    DeltaQuantized  // Positions rounded to a fixed grid, stored as varint residuals
+                    // against a linear prediction from the two previous frames
+};
+
+// Structure to hold trajectory recording parameters
+struct TrajectorySettings {
+    TrajectoryEncoding encoding = TrajectoryEncoding::DeltaQuantized;
+    double quantization = 1e-5;         // Grid spacing in scene units for DeltaQuantized
+    size_t framesPerChunk = 64;         // Frames per chunk; each chunk is decoded independently
+    size_t maxChunkBytes = 64 << 20;    // A chunk is also closed once its data reaches this size
+    size_t bufferFrames = 16;           // Ring buffer slots between the step and the writer thread
+    bool blocking = true;               // Wait for a free slot when the buffer is full instead of dropping the frame;
+                                        // always on under deterministic scheduling
+};
+
+// Structure to hold one entry of a trajectory file's chunk index
+struct TrajectoryChunk {
+    uint64_t offset;                // Byte offset of the chunk header in the file
+    uint64_t firstStep, lastStep;
+    double firstTime, lastTime;
+    uint64_t frameCount;
+};
+
+class TrajectoryWriter {
+public:
+    TrajectoryWriter() = default;
+    ~TrajectoryWriter();
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    // Function to create a new trajectory file and start the writer thread
+    bool open(const std::string& path, size_t bodyCount, double timeStep, const TrajectorySettings& settings,
+        std::string& error);
+
+    // Function to continue a file left by an earlier (possibly interrupted) run.
+    // Frames after resumeStep are discarded so it lines up with the checkpoint
+    // being resumed. Encoding and body count come from the file; chunking and
+    // buffering are taken from settings, which must match the original run's
+    // for the finished file to be identical to an uninterrupted recording.
+    bool openForResume(const std::string& path, uint64_t resumeStep, const TrajectorySettings& settings,
+        std::string& error);
+
+    // Function to queue the engine's current positions. When the writer has fallen
+    // a whole buffer behind, a blocking writer waits for a free slot; otherwise the
+    // frame is dropped and false returned.
+    bool record(const SimulationEngine& engine);
+
+    // Function to queue a checkpoint of the full engine state, written to path
+    // once every frame recorded before it is on disk. Returns false and skips it
+    // while the previous checkpoint is still being written.
+    bool requestCheckpoint(const SimulationEngine& engine, const std::string& path);
+
+    // Function to drain the buffer, write the time index and stop the thread.
+    // Returns false with the first I/O error hit by the writer thread.
+    bool close(std::string& error);
+
+    bool isOpen() const { return thread_.joinable(); }
+    uint64_t framesWritten() const { return framesWritten_.load(); }
+    uint64_t framesDropped() const { return framesDropped_.load(); }
+    uint64_t bytesWritten() const { return bytesWritten_.load(); }
+    uint64_t checkpointsWritten() const { return checkpointsWritten_.load(); }
+
+private:
+    void start();
+    void run();
+    void encodeFrame(const SimulationSnapshot& frame);
+    bool flushChunk();
+    bool writeCheckpointNow();
+    void fail(const std::string& message);
+
+    std::string path_;
+    std::ofstream file_;
+    uint64_t fileSize_ = 0;
+    size_t bodyCount_ = 0;
+    TrajectorySettings settings_;
+
+    // Ring buffer shared with the stepping thread; head_ is only advanced by
+    // record() and tail_ only by the writer thread, which signals space_ as it frees slots
+    std::vector<SimulationSnapshot> slots_;
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+    std::atomic<bool> stopping_{false};
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::mutex spaceMutex_;
+    std::condition_variable space_;
+    std::thread thread_;
+
+    // Pending checkpoint, owned by the writer thread while checkpointPending_ is set
+    SimulationState checkpointState_;
+    std::string checkpointPath_;
+    uint64_t checkpointHead_ = 0;
+    std::atomic<bool> checkpointPending_{false};
+
+    // Chunk being assembled by the writer thread
+    std::vector<char> chunkFrames_;     // Frame table entries
+    std::vector<char> chunkData_;
+    std::vector<int64_t> previous_, beforePrevious_;   // Quantized x then y of the last two frames
+    TrajectoryChunk chunk_ = {};
+    std::vector<TrajectoryChunk> index_;
+
+    std::atomic<uint64_t> framesWritten_{0};
+    std::atomic<uint64_t> framesDropped_{0};
+    std::atomic<uint64_t> bytesWritten_{0};
+    std::atomic<uint64_t> checkpointsWritten_{0};
+    std::atomic<bool> failed_{false};
+    std::string error_;
+};
+
+class TrajectoryReader {
+public:
+    // Function to map a trajectory file. A file whose writer never closed it has
+    // no index; the complete chunks are then found by scanning.
+    bool open(const std::string& path, std::string& error);
+
+    size_t bodyCount() const { return bodyCount_; }
+    double timeStep() const { return timeStep_; }
+    TrajectoryEncoding encoding() const { return encoding_; }
+    double quantization() const { return quantization_; }
+    uint64_t frameCount() const { return frameCount_; }
+    size_t chunkCount() const { return chunks_.size(); }
+    bool recovered() const { return recovered_; }
+
+    // Function to return the step and time of a frame without decoding positions
+    uint64_t frameStep(uint64_t frame) const;
+    double frameTime(uint64_t frame) const;
+
+    // Function to find the last frame at or before time; false if time precedes the first frame
+    bool findFrame(double time, uint64_t& frame) const;
+
+    // Function to decode a frame. Reading frames in order is cheapest.
+    bool readFrame(uint64_t frame, SimulationSnapshot& out);
+
+    // Function to point straight into the mapping for a frame of a Raw chunk;
+    // returns false for compressed chunks
+    bool rawFrame(uint64_t frame, const float*& x, const float*& y) const;
+
+private:
+    friend class TrajectoryWriter;
+
+    // Structure to hold an index entry and where the chunk's parts sit in the mapping
+    struct Chunk {
+        TrajectoryChunk info;
+        uint64_t firstFrame;    // Frame number of the chunk's first frame across the file
+        uint64_t end;           // Byte offset just past the chunk, padding included
+        const char* frames;     // Frame table
+        const char* data;
+        const char* dataEnd;
+    };
+
+    size_t chunkOf(uint64_t frame) const;
+    static bool frameFits(const Chunk& chunk, uint64_t offset, size_t bytes);
+    bool decodeFrame(const Chunk& chunk, uint64_t local, bool output, SimulationSnapshot& out);
+
+    MappedFile file_;
+    size_t bodyCount_ = 0;
+    double timeStep_ = 0.0;
+    double quantization_ = 0.0;
+    TrajectoryEncoding encoding_ = TrajectoryEncoding::Raw;
+    uint64_t frameCount_ = 0;
+    bool recovered_ = false;
+    std::vector<Chunk> chunks_;
+
+    // Decoder position for DeltaQuantized chunks, so sequential reads do not restart each chunk
+    size_t cursorChunk_ = SIZE_MAX;
+    uint64_t cursorFrame_ = 0;      // Next frame within the chunk to decode
+    std::vector<int64_t> previous_, beforePrevious_;
+};
+
+// Function to write a checkpoint file holding the complete engine state. The
+// file is written beside path and renamed over it, so an interruption never
+// leaves a half-written checkpoint behind.
+bool writeCheckpoint(const std::string& path, const SimulationState& state, std::string& error);
+
+// Function to read a checkpoint written by writeCheckpoint or TrajectoryWriter
+bool readCheckpoint(const std::string& path, SimulationState& state, std::string& error);
@@ -0,0 +1,55 @@
+// BarnesHutTest.cpp : Checks Barnes-Hut mutual accelerations against the direct
+// O(N^2) sum for a belt of equal-mass asteroids, with no planets to dominate the forces.
+//
+#include "BodyCatalog.h"
+#include "NBody.h"
+#include "TestSupport.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+// Enough bodies for a tree many levels deep while the direct sum stays quick
+const size_t ASTEROIDS = 10000;
+
+// Solar masses per asteroid, so every body is a tree source
+const float ASTEROID_MASS = 1e-12f;
+
+// At the default opening angle of 0.5 the error of each body's acceleration,
+// relative to the mean acceleration magnitude, must stay below these bounds
+const double MAX_RMS_ERROR = 0.01;
+const double MAX_BODY_ERROR = 0.02;
+
+int main() {
+    BodyCatalog catalog;
+    addAsteroidBelt(catalog, ASTEROIDS, 2, ASTEROID_MASS);
+    NBodySystem system;
+    initializeNBodySystem(system, catalog.elements, catalog.masses);
+
+    NBodySettings settings;
+    settings.method = ForceMethod::Direct;
+    std::vector<double> directX, directY, treeX, treeY;
+    NBodyIntegrator(settings).computeAccelerations(system, false, directX, directY);
+    settings.method = ForceMethod::BarnesHut;
+    NBodyIntegrator(settings).computeAccelerations(system, false, treeX, treeY);
+
+    size_t count = system.size();
+    double meanMagnitude = 0.0;
+    for (size_t i = 0; i < count; i++) meanMagnitude += std::hypot(directX[i], directY[i]);
+    meanMagnitude /= static_cast<double>(count);
+
+    double squaredError = 0.0, maxError = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double error = std::hypot(treeX[i] - directX[i], treeY[i] - directY[i]) / meanMagnitude;
+        squaredError += error * error;
+        maxError = std::max(maxError, error);
+    }
+    double rmsError = std::sqrt(squaredError / static_cast<double>(count));
+
+    std::ostringstream errors;
+    errors << "RMS error " << rmsError << ", worst body " << maxError << " of the mean acceleration";
+    std::cout << count << " bodies: " << errors.str() << std::endl;
+    check(meanMagnitude > 0.0, "bodies attract each other");
+    check(rmsError < MAX_RMS_ERROR && maxError < MAX_BODY_ERROR, "Barnes-Hut " + errors.str());
+    return testResult();
+}
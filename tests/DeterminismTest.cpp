@@ -0,0 +1,66 @@
+// DeterminismTest.cpp : Checks that deterministic scheduling gives bit-identical
+// positions on four workers to a single-threaded run, in Kepler and N-body mode.
+//
+#include "BodyCatalog.h"
+#include "Parallel.h"
+#include "SimulationEngine.h"
+#include "TestSupport.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Enough bodies that every parallel loop splits into several blocks
+const size_t KEPLER_ASTEROIDS = 100000;
+const size_t NBODY_ASTEROIDS = 5000;
+const uint64_t KEPLER_STEPS = 400;
+const uint64_t NBODY_STEPS = 20;
+
+// Solar masses per asteroid, so the N-body case builds a tree of every body
+const float ASTEROID_MASS = 1e-12f;
+
+// Function to run the engine under the given scheduler and return its final positions
+std::vector<float> runEngine(const SchedulerSettings& scheduler, bool nbody, ForceMethod method) {
+    configureScheduler(scheduler);
+    BodyCatalog catalog;
+    makeDefaultCatalog(catalog, 1);
+    addAsteroidBelt(catalog, nbody ? NBODY_ASTEROIDS : KEPLER_ASTEROIDS, 2, nbody ? ASTEROID_MASS : 0.0f);
+
+    SimulationEngine engine;
+    engine.setElements(catalog.elements);
+    if (nbody) {
+        NBodySettings settings;
+        settings.method = method;
+        engine.enableNBody(settings, catalog.masses);
+    }
+    // Steps go in uneven batches so both the per-call and per-step paths are used
+    uint64_t steps = nbody ? NBODY_STEPS : KEPLER_STEPS;
+    for (uint64_t done = 0; done < steps; done += 7) engine.step(std::min<uint64_t>(7, steps - done));
+
+    const BodyPositions& positions = engine.positions();
+    std::vector<float> result(positions.x.begin(), positions.x.end());
+    result.insert(result.end(), positions.y.begin(), positions.y.end());
+    return result;
+}
+
+// Function to compare a single-threaded run with a deterministic four-worker run
+void checkCase(const std::string& name, bool nbody, ForceMethod method) {
+    SchedulerSettings single;
+    single.workers = 1;
+    SchedulerSettings parallel;
+    parallel.workers = 4;
+    parallel.deterministic = true;
+
+    std::vector<float> expected = runEngine(single, nbody, method);
+    std::vector<float> actual = runEngine(parallel, nbody, method);
+    bool same = expected.size() == actual.size() &&
+        std::memcmp(expected.data(), actual.data(), expected.size() * sizeof(float)) == 0;
+    check(same, name + ": deterministic positions on 4 workers differ from 1 worker");
+}
+
+int main() {
+    checkCase("Kepler", false, ForceMethod::BarnesHut);
+    checkCase("N-body Barnes-Hut", true, ForceMethod::BarnesHut);
+    checkCase("N-body direct", true, ForceMethod::Direct);
+    return testResult();
+}
@@ -0,0 +1,57 @@
+// KeplerBackendTest.cpp : Checks the batch Kepler solve of the backend this
+// executable was built for against the double-precision keplerPositionAt, from
+// circular to near-parabolic orbits.
+//
+#include "KeplerPropagator.h"
+#include "TestSupport.h"
+#include <cmath>
+#include <random>
+#include <sstream>
+
+// Bodies per eccentricity; not a multiple of any lane width, so the tail is covered
+const size_t BODIES_PER_CASE = 4099;
+
+// Largest position error allowed, in units of the semi-major axis
+const double MAX_POSITION_ERROR = 1e-5;
+
+const float ECCENTRICITIES[] = { 0.0f, 0.0167f, 0.249f, 0.5f, 0.9f, 0.99f, 0.999f };
+
+int main() {
+    const float twoPi = 6.2831853f;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> axis(0.5f, 60.0f);
+    std::uniform_real_distribution<float> angle(0.0f, twoPi);
+
+    for (float eccentricity : ECCENTRICITIES) {
+        OrbitalElements elements;
+        elements.resize(BODIES_PER_CASE);
+        for (size_t i = 0; i < BODIES_PER_CASE; i++) {
+            // The first bodies sit at the ends of the anomaly range, where Newton starts worst
+            float meanAnomaly = i == 0 ? 0.0f : i == 1 ? 1e-4f : i == 2 ? twoPi - 1e-4f : i == 3 ? 3.1415926f : angle(rng);
+            float a = axis(rng);
+            elements.set(i, a, eccentricity, std::pow(a, 1.5f), meanAnomaly, angle(rng));
+        }
+        BodyPositions positions;
+        positions.resize(BODIES_PER_CASE);
+        solvePositions(elements, positions, 0, BODIES_PER_CASE);
+
+        double maxError = 0.0;
+        size_t worst = 0;
+        for (size_t i = 0; i < BODIES_PER_CASE; i++) {
+            double x, y;
+            keplerPositionAt(elements, i, 0.0, x, y);
+            double error = std::hypot(positions.x[i] - x, positions.y[i] - y) / elements.semiMajorAxis[i];
+            if (!std::isfinite(error)) error = INFINITY;
+            if (error > maxError) {
+                maxError = error;
+                worst = i;
+            }
+        }
+        std::ostringstream what;
+        what << keplerBackendName() << " at e = " << eccentricity << ": error " << maxError << " (body " << worst
+            << ") exceeds " << MAX_POSITION_ERROR;
+        check(maxError <= MAX_POSITION_ERROR, what.str());
+        std::cout << keplerBackendName() << ", e = " << eccentricity << ": max error " << maxError << std::endl;
+    }
+    return testResult();
+}
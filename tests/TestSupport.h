@@ -0,0 +1,28 @@
+// TestSupport.h : Minimal checks shared by the ctest executables. Each test is a
+// plain program that reports every failed check and exits non-zero if any failed.
+
+#pragma once
+
+#include <iostream>
+#include <string>
+
+// Function to return the number of failed checks so far
+inline int& failedChecks() {
+    static int count = 0;
+    return count;
+}
+
+// Function to record a check; prints what failed and returns the condition
+inline bool check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failedChecks()++;
+    }
+    return condition;
+}
+
+// Function to return the exit code for main
+inline int testResult() {
+    if (failedChecks() > 0) std::cerr << failedChecks() << " check(s) failed" << std::endl;
+    return failedChecks() > 0 ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+// TrajectoryTest.cpp : Checks that a recording interrupted after a checkpoint and
+// resumed from it is byte-identical to an uninterrupted one, that checkpoints
+// round-trip the full state, and that truncated or corrupt files fail cleanly.
+//
+#include "BodyCatalog.h"
+#include "SimulationEngine.h"
+#include "TestSupport.h"
+#include "Trajectory.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+const size_t ASTEROIDS = 2000;
+const uint64_t RECORD_EVERY = 3;
+const uint64_t TOTAL_STEPS = 300;
+
+// Not on a chunk boundary, so the checkpoint closes a chunk early
+const uint64_t CHECKPOINT_STEP = 150;
+
+// The interrupted run gets this far before it dies, leaving frames past the checkpoint
+const uint64_t INTERRUPT_STEP = 240;
+
+// Small chunks so the file holds many of them
+const size_t FRAMES_PER_CHUNK = 8;
+
+// Byte offsets of FileHeader fields and of the index footer (see Trajectory.cpp)
+const size_t HEADER_ENCODING = 12;
+const size_t HEADER_BODY_COUNT = 16;
+const size_t HEADER_MODE = 48;
+const size_t HEADER_METHOD = 52;
+const size_t HEADER_SCHEME = 56;
+const size_t HEADER_NBODY_COUNT = 80;
+const size_t FOOTER_SIZE = 32;
+
+// Function to read a whole file
+std::vector<char> readBytes(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Function to replace a file's contents
+void writeBytes(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Function to write a copy of source with value stored at offset
+template <typename T>
+void writePatched(const std::string& path, std::vector<char> bytes, size_t offset, T value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    writeBytes(path, bytes);
+}
+
+// Function to set up the engine every run starts from
+void startEngine(SimulationEngine& engine, bool nbody) {
+    BodyCatalog catalog;
+    makeDefaultCatalog(catalog, 1);
+    addAsteroidBelt(catalog, ASTEROIDS, 2, nbody ? 1e-12f : 0.0f);
+    engine.setElements(catalog.elements);
+    if (nbody) engine.enableNBody(NBodySettings(), catalog.masses);
+}
+
+// Function to step to lastStep, recording every RECORD_EVERY steps and
+// requesting a checkpoint at CHECKPOINT_STEP, the way the headless runner does
+void recordUntil(SimulationEngine& engine, TrajectoryWriter& writer, uint64_t lastStep, const std::string& checkpointPath) {
+    while (engine.stepIndex() < lastStep) {
+        engine.step(RECORD_EVERY);
+        writer.record(engine);
+        if (engine.stepIndex() == CHECKPOINT_STEP) check(writer.requestCheckpoint(engine, checkpointPath), "checkpoint request");
+    }
+}
+
+// Function to compare two states field by field
+bool sameState(const SimulationState& a, const SimulationState& b) {
+    if (a.mode != b.mode || a.timeStep != b.timeStep || a.step != b.step || a.elements.size() != b.elements.size() ||
+        a.nbodySettings.method != b.nbodySettings.method || a.nbodySettings.scheme != b.nbodySettings.scheme ||
+        a.nbodySettings.openingAngle != b.nbodySettings.openingAngle || a.nbodySettings.softening != b.nbodySettings.softening ||
+        a.nbody.size() != b.nbody.size()) return false;
+    const float* arraysA[ELEMENT_ARRAY_COUNT];
+    const float* arraysB[ELEMENT_ARRAY_COUNT];
+    a.elements.arrays(arraysA);
+    b.elements.arrays(arraysB);
+    for (int s = 0; s < ELEMENT_ARRAY_COUNT; s++) {
+        if (std::memcmp(arraysA[s], arraysB[s], a.elements.size() * sizeof(float)) != 0) return false;
+    }
+    return a.nbody.x == b.nbody.x && a.nbody.y == b.nbody.y && a.nbody.vx == b.nbody.vx && a.nbody.vy == b.nbody.vy &&
+        a.nbody.mu == b.nbody.mu;
+}
+
+// Function to record with and without an interruption and compare the files
+void checkResume(const std::filesystem::path& directory, TrajectoryEncoding encoding, const std::string& name) {
+    std::string whole = (directory / (name + "-whole.sstr")).string();
+    std::string resumed = (directory / (name + "-resumed.sstr")).string();
+    std::string checkpoint = (directory / (name + ".sscp")).string();
+    TrajectorySettings settings;
+    settings.encoding = encoding;
+    settings.framesPerChunk = FRAMES_PER_CHUNK;
+    std::string error;
+
+    SimulationEngine uninterrupted;
+    startEngine(uninterrupted, false);
+    TrajectoryWriter writer;
+    check(writer.open(whole, uninterrupted.bodyCount(), uninterrupted.timeStep(), settings, error), name + ": open: " + error);
+    recordUntil(uninterrupted, writer, TOTAL_STEPS, (directory / (name + "-unused.sscp")).string());
+    check(writer.close(error), name + ": close: " + error);
+
+    // The interrupted run dies mid-chunk past the checkpoint: no index, and a torn last chunk
+    SimulationEngine interrupted;
+    startEngine(interrupted, false);
+    check(writer.open(resumed, interrupted.bodyCount(), interrupted.timeStep(), settings, error), name + ": open: " + error);
+    recordUntil(interrupted, writer, INTERRUPT_STEP, checkpoint);
+    check(writer.close(error), name + ": close: " + error);
+    std::vector<char> bytes = readBytes(resumed);
+    bytes.resize(bytes.size() - FOOTER_SIZE - bytes.size() / 20);
+    writeBytes(resumed, bytes);
+
+    SimulationState state;
+    if (!check(readCheckpoint(checkpoint, state, error), name + ": read checkpoint: " + error)) return;
+    check(state.step == CHECKPOINT_STEP, name + ": checkpoint is at the requested step");
+    SimulationEngine restarted;
+    restarted.restoreState(state);
+    check(writer.openForResume(resumed, restarted.stepIndex(), settings, error), name + ": resume: " + error);
+    recordUntil(restarted, writer, TOTAL_STEPS, checkpoint);
+    check(writer.close(error), name + ": close: " + error);
+
+    check(readBytes(whole) == readBytes(resumed), name + ": resumed recording differs from the uninterrupted one");
+    check(std::memcmp(uninterrupted.positions().x.data(), restarted.positions().x.data(), ASTEROIDS * sizeof(float)) == 0,
+        name + ": resumed positions differ");
+
+    TrajectoryReader reader;
+    if (check(reader.open(resumed, error), name + ": reopen: " + error)) {
+        check(!reader.recovered() && reader.frameCount() == TOTAL_STEPS / RECORD_EVERY, name + ": resumed file is indexed and complete");
+    }
+}
+
+// Function to write a checkpoint of an N-body run, read it back and continue both
+void checkCheckpointRoundTrip(const std::filesystem::path& directory) {
+    std::string path = (directory / "nbody.sscp").string();
+    std::string error;
+    SimulationEngine engine;
+    startEngine(engine, true);
+    engine.step(10);
+
+    SimulationState saved, loaded;
+    engine.saveState(saved);
+    check(writeCheckpoint(path, saved, error), "write checkpoint: " + error);
+    if (!check(readCheckpoint(path, loaded, error), "read checkpoint: " + error)) return;
+    check(sameState(saved, loaded), "checkpoint round trip changes the state");
+
+    SimulationEngine restored;
+    restored.restoreState(loaded);
+    engine.step(10);
+    restored.step(10);
+    check(std::memcmp(engine.positions().x.data(), restored.positions().x.data(), engine.bodyCount() * sizeof(float)) == 0 &&
+        std::memcmp(engine.positions().y.data(), restored.positions().y.data(), engine.bodyCount() * sizeof(float)) == 0,
+        "restored N-body run diverges");
+}
+
+// Function to check that damaged files are rejected or recovered without reading past the end
+void checkDamagedFiles(const std::filesystem::path& directory) {
+    std::string checkpoint = (directory / "nbody.sscp").string();
+    std::string trajectory = (directory / "raw-whole.sstr").string();
+    std::string damaged = (directory / "damaged").string();
+    std::vector<char> checkpointBytes = readBytes(checkpoint);
+    std::vector<char> trajectoryBytes = readBytes(trajectory);
+    std::string error;
+    SimulationState state;
+    TrajectoryReader reader;
+
+    // Checkpoints
+    writeBytes(damaged, std::vector<char>(checkpointBytes.begin(), checkpointBytes.begin() + checkpointBytes.size() / 2));
+    check(!readCheckpoint(damaged, state, error), "truncated checkpoint is accepted");
+    writeBytes(damaged, std::vector<char>(checkpointBytes.begin(), checkpointBytes.begin() + 20));
+    check(!readCheckpoint(damaged, state, error), "checkpoint cut inside the header is accepted");
+    writePatched(damaged, checkpointBytes, HEADER_BODY_COUNT, uint64_t(1) << 62);
+    check(!readCheckpoint(damaged, state, error), "checkpoint with 2^62 bodies is accepted");
+    writePatched(damaged, checkpointBytes, HEADER_NBODY_COUNT, uint64_t(1) << 62);
+    check(!readCheckpoint(damaged, state, error), "checkpoint with 2^62 N-body states is accepted");
+    writePatched(damaged, checkpointBytes, HEADER_NBODY_COUNT, uint64_t(ASTEROIDS / 2));
+    check(!readCheckpoint(damaged, state, error), "checkpoint with fewer N-body states than bodies is accepted");
+    writePatched(damaged, checkpointBytes, HEADER_MODE, uint32_t(7));
+    check(!readCheckpoint(damaged, state, error), "checkpoint with an unknown mode is accepted");
+    writePatched(damaged, checkpointBytes, HEADER_METHOD, uint32_t(7));
+    check(!readCheckpoint(damaged, state, error), "checkpoint with an unknown force method is accepted");
+    writePatched(damaged, checkpointBytes, HEADER_SCHEME, uint32_t(7));
+    check(!readCheckpoint(damaged, state, error), "checkpoint with an unknown integrator is accepted");
+    check(!readCheckpoint(trajectory, state, error), "trajectory is accepted as a checkpoint");
+
+    // Trajectories
+    writeBytes(damaged, std::vector<char>(trajectoryBytes.begin(), trajectoryBytes.begin() + 20));
+    check(!reader.open(damaged, error), "trajectory cut inside the header is accepted");
+    writePatched(damaged, trajectoryBytes, HEADER_BODY_COUNT, uint64_t(1) << 62);
+    check(!reader.open(damaged, error), "trajectory with 2^62 bodies is accepted");
+    writePatched(damaged, trajectoryBytes, HEADER_ENCODING, uint32_t(7));
+    check(!reader.open(damaged, error), "trajectory with an unknown encoding is accepted");
+    uint64_t indexOffset;
+    std::memcpy(&indexOffset, trajectoryBytes.data() + trajectoryBytes.size() - FOOTER_SIZE, sizeof(indexOffset));
+    writePatched(damaged, trajectoryBytes, indexOffset, uint64_t(1) << 62);
+    check(!reader.open(damaged, error), "trajectory with a chunk index entry past the end is accepted");
+
+    // A torn file loses its index and last chunk, but every complete chunk stays readable
+    writeBytes(damaged, std::vector<char>(trajectoryBytes.begin(), trajectoryBytes.begin() + trajectoryBytes.size() / 2));
+    if (check(reader.open(damaged, error), "open torn trajectory: " + error)) {
+        check(reader.recovered() && reader.frameCount() > 0 && reader.frameCount() < TOTAL_STEPS / RECORD_EVERY,
+            "torn trajectory recovers only its complete chunks");
+        SimulationSnapshot frame;
+        bool readable = true;
+        for (uint64_t f = 0; f < reader.frameCount(); f++) readable = readable && reader.readFrame(f, frame);
+        check(readable, "recovered frames decode");
+    }
+}
+
+int main() {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "SolarSystemTrajectoryTest";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    checkResume(directory, TrajectoryEncoding::Raw, "raw");
+    checkResume(directory, TrajectoryEncoding::DeltaQuantized, "quantized");
+    checkCheckpointRoundTrip(directory);
+    checkDamagedFiles(directory);
+
+    std::filesystem::remove_all(directory);
+    return testResult();
+}